@@ -17,13 +17,18 @@ solution_paths = [
     "../risin/vk_radiotorni_ok.cpp",]
 checker_path = "./checker.cpp"
 examples_dir = "./examples"
+tests_archive = "./testi/tests.zip"  # tests_archive of task.yaml
 
 # ================================
 
 from pygenlib.isolate import *
-from pygenlib.testgen import Generator
+from pygenlib.testgen import GenScheduler, GeneratorConfig, validate_tests
 from pygenlib.clean import clean
-from pygenlib.report import Reporter
+from pygenlib.report import ReporterConfig, report_all
+from pygenlib.benchmark import benchmark
+from pygenlib.stress import stress
+from pygenlib.testpack import build_archive
+from pygenlib import trace
 from pygenlib.tgyaml import TgYaml
 
 logger = logging.getLogger(__name__)
@@ -32,33 +37,111 @@ logger = logging.getLogger(__name__)
 tests_dir = "./tests"
 reports_dir = "./reports"
 
-reporter = Reporter(task_name, tests_dir=tests_dir, checker_path=checker_path)
+reporter_cfg = ReporterConfig(
+    task_name=task_name,
+    tests_dir=tests_dir,
+    checker_path=checker_path,
+    testlib_path="./testlib.h",
+    cache_dir="./cache",
+    reports_dir=reports_dir,
+    memory_limit=256,  # MiB, memory_limit of task.yaml
+    memory_profile=True,  # peak memory and allocation time per testgroup in reports/*_memory.tsv
+    checker_extra_files={"input_schema.h": "./input_schema.h"},  # input layout shared with validator.cpp
+    calibrate=True,  # [norm] column comparable between machines, judge_calibration="judge.json" adds judge times
+)
 tg_yaml = TgYaml()
 record_tg = tg_yaml.record_tg
 
 model_solution = solution_paths[0]
-generator = Generator(task_name, model_solution, tests_dir=tests_dir)
+# gen() only queues the test, gen_tests() generates all of them in parallel isolate boxes,
+# the generator output is piped straight into the model solution and the validator
+generator_cfg = GeneratorConfig(
+    task_name=task_name,
+    model_solution_path=model_solution,
+    generator_path="./gen.cpp",
+    testlib_header_path="./testlib.h",
+    tests_dir=tests_dir,
+    gen_extra_files={"treegen.h": "./treegen.h"},
+    validator_path="./validator.cpp",
+    validator_extra_files={"input_schema.h": "./input_schema.h"},
+    compress_tests=True,  # tests are stored as radiotorni.i01a.gz, ...
+)
+# GenScheduler(generator_cfg, multigen=True) would start gen.cpp once per testgroup instead
+generator = GenScheduler(generator_cfg, pipeline=True)
+# (input file, validator group) of every test, for gen_coverage()
+validated_tests = []
 def gen(tg_ext, *args):
-    generator.gen(tg_ext, *args)
+    # validator.cpp groups are numbered from 0 (examples), one below the subtask of the last record_tg()
+    subtask = tg_yaml.tg_info[-1]["subtask"]
+    generator.gen(tg_ext, *args, group=str(subtask - 1))
+    validated_tests.append((f"{tests_dir}/{task_name}.i{tg_ext}.gz", str(subtask - 1)))
 
 min_n = 2
 max_n = 500000
 max_freq = 10**9
 
 def main():
+    # every stage, isolate run, build and cache lookup is timed, see reports/radiotorni_trace.json and .tsv
+    trace.enable()
     clean()
     # gen_tests()
     # tg_yaml.export()
     # gen_reports()
+    # gen_benchmark()
+    # gen_archive()
+    # gen_coverage()
+    # gen_stress()
+    trace.write(f"{reports_dir}/{task_name}_trace")
 
+@trace.traced()
 def gen_reports():
     logger.info("Generating reports")
     os.makedirs(reports_dir, exist_ok=True)
-    
-    for sol in solution_paths:
-        reporter.report(sol)
+
+    # all (solution, test) pairs run in parallel, one isolate box per CPU core
+    report_all(solution_paths, cfg=reporter_cfg)
+
+
+@trace.traced()
+def gen_benchmark():
+    logger.info("Benchmarking solutions")
+    # 5 runs per (solution, test), slowdown against the model solution per testgroup
+    benchmark(solution_paths, repeats=5, model_solution=model_solution, cfg=reporter_cfg, workers=1)
+
+
+@trace.traced()
+def gen_archive():
+    logger.info(f"Packing tests into {tests_archive}")
+    # compressed tests are copied into the zip without decompressing them
+    build_archive(tests_dir, tests_archive)
+
+
+@trace.traced()
+def gen_coverage():
+    logger.info("Validating all tests in one validator process")
+    os.makedirs(reports_dir, exist_ok=True)
+    # per subtask: how many tests reach the minimum and maximum of each variable
+    validate_tests(validated_tests, cfg=generator_cfg, coverage_path=f"{reports_dir}/{task_name}_coverage.txt")
+
+
+def stress_args(n, rng):
+    """gen.cpp arguments for a small random test with n vertices"""
+    r = rng.randint(2, 10)
+    l = rng.randint(1, r - 1)
+    tree_type = rng.choice(["star", "line", "binary", "random", "prufer", "caterpillar", "broom"])
+    freq_way = rng.choice(["random", "walk"])
+    return [n, l, r, tree_type, freq_way, l, r]
 
 
+@trace.traced()
+def gen_stress():
+    logger.info("Searching for counterexamples")
+    # random small tests until a solution disagrees with the model solution, the failing test shrunk to the smallest n
+    for sol_path in solution_paths[1:]:
+        stress(sol_path, stress_args, sizes=range(min_n, 13), cfg=generator_cfg, reporter_cfg=reporter_cfg)
+
+
+@trace.traced()
 def gen_tests():
     logger.info("Generating test cases")
     os.makedirs(tests_dir, exist_ok=True)
@@ -70,12 +153,16 @@ def gen_tests():
     gen_subtask5()
     gen_subtask6()
 
+    generator.run()
+
 def gen_subtask1():
     """Copy example files to tests directory"""
     logger.info("Copying example files to tests directory")
     for filename in os.listdir(examples_dir):
         logger.debug(f"Copying example file: {filename}")
         shutil.copy(examples_dir + "/" + filename, tests_dir + "/" + filename)
+        if filename.startswith(f"{task_name}.i"):
+            validated_tests.append((tests_dir + "/" + filename, "0"))
 
 def gen_subtask2():
     """N <= 10, 13 points"""
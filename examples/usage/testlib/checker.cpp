@@ -1,113 +1,97 @@
 #include "testlib.h"
+#include "input_schema.h"
 #include <vector>
-#include <set>
-#include <utility>
-#include <algorithm>
+#include <cstdlib>
 
 using namespace std;
 
-bool hasConflicts(const vector<int>& frequencies, const vector<vector<int>>& adj) {
-    int n = frequencies.size() - 1;
-    for (int i = 1; i <= n; i++) {
-        for (int neighbor : adj[i]) {
-            if (i < neighbor) { // Check each edge only once
-                if (frequencies[i] == frequencies[neighbor]) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
-}
-
 int main(int argc, char *argv[]) {
     registerTestlibCmd(argc, argv);
 
-    // Read input data
-    int n = inf.readInt();
-    int k = inf.readInt();
-    int l = inf.readInt();
-
-    // Read initial frequencies
-    vector<int> initial_freq(n + 1);
-    for (int i = 1; i <= n; i++) {
-        initial_freq[i] = inf.readInt();
-    }
-
-    // Read tower connections as adjacency list
-    vector<vector<int>> adj(n + 1);
-    for (int i = 0; i < n - 1; i++) {
-        int a = inf.readInt();
-        int b = inf.readInt();
-        adj[a].push_back(b);
-        adj[b].push_back(a);
-    }
+    // Read input data: initial frequencies of towers 1..n at initial_freq[0..n-1],
+    // tower connections as a flat edge list: tower edges[2*i] is connected to edges[2*i+1]
+    radiotorni::Input input;
+    input.read(inf);
+    int n = int(input.get<radiotorni::N>());
+    int k = int(input.get<radiotorni::K>());
+    int l = int(input.get<radiotorni::L>());
+    const vector<int> &initial_freq = input.array<radiotorni::f>();
+    const vector<int> &edges = input.array<radiotorni::edge>();
+    // With --server, every output checked against this input continues from here
+    checker.inputRead();
 
     // Read participant's output
     int participant_changes = ouf.readInt();
     
     // Read the participant's final frequencies
     vector<int> participant_freq(n + 1);
-    for (int i = 1; i <= n; i++) {
-        participant_freq[i] = ouf.readInt();
-    }
+    ouf.readIntsTo(participant_freq.data() + 1, n);
 
     // Read jury's output for reference (minimal number of changes)
     int jury_changes = ans.readInt();
     
     // Read jury's solution frequencies to verify its correctness
     vector<int> jury_freq(n + 1);
+    ans.readIntsTo(jury_freq.data() + 1, n);
+
+    // Both solutions are verified in one pass over the towers and one over the edges.
+    // The first violation of every check is remembered and reported below, in the order of the checks.
+    int jury_bad_tower = 0, jury_actual_changes = 0;
+    int range_bad_tower = 0, diff_bad_tower = 0, actual_changes = 0;
     for (int i = 1; i <= n; i++) {
-        jury_freq[i] = ans.readInt();
+        int jury_diff = abs(jury_freq[i] - initial_freq[i - 1]);
+        if (jury_bad_tower == 0 && (jury_freq[i] < k || jury_freq[i] > l || jury_diff > 1)) {
+            jury_bad_tower = i;
+        }
+        jury_actual_changes += jury_diff > 0;
+
+        if (range_bad_tower == 0 && (participant_freq[i] < k || participant_freq[i] > l)) {
+            range_bad_tower = i;
+        }
+        int diff = abs(participant_freq[i] - initial_freq[i - 1]);
+        if (diff_bad_tower == 0 && diff > 1) {
+            diff_bad_tower = i;
+        }
+        actual_changes += diff > 0;
+    }
+
+    bool jury_conflicts = false, participant_conflicts = false;
+    for (size_t e = 0; e < edges.size(); e += 2) {
+        int a = edges[e], b = edges[e + 1];
+        jury_conflicts |= jury_freq[a] == jury_freq[b];
+        participant_conflicts |= participant_freq[a] == participant_freq[b];
     }
 
     // Verify jury's solution is correct
-    for (int i = 1; i <= n; i++) {
+    if (jury_bad_tower != 0) {
+        int i = jury_bad_tower;
         if (jury_freq[i] < k || jury_freq[i] > l) {
             quitf(_fail, "Jury's solution: Frequency for tower %d is outside the valid range [%d, %d]", i, k, l);
         }
-        
-        int diff = abs(jury_freq[i] - initial_freq[i]);
-        if (diff > 1) {
-            quitf(_fail, "Jury's solution: Tower %d frequency was changed by %d, which exceeds the allowed +/-1", i, diff);
-        }
+        quitf(_fail, "Jury's solution: Tower %d frequency was changed by %d, which exceeds the allowed +/-1",
+              i, abs(jury_freq[i] - initial_freq[i - 1]));
     }
     
     // Verify jury's solution has no conflicts
-    if (hasConflicts(jury_freq, adj)) {
+    if (jury_conflicts) {
         quitf(_fail, "Jury's solution still has frequency conflicts");
     }
     
     // Verify jury's actual changes match their reported changes
-    int jury_actual_changes = 0;
-    for (int i = 1; i <= n; i++) {
-        if (jury_freq[i] != initial_freq[i]) {
-            jury_actual_changes++;
-        }
-    }
-    
     if (jury_actual_changes != jury_changes) {
         quitf(_fail, "Jury's solution: Reported %d changes, but actually performed %d changes", 
               jury_changes, jury_actual_changes);
     }
 
     // Check 1: Verify that all frequencies are within the valid range [K, L]
-    for (int i = 1; i <= n; i++) {
-        if (participant_freq[i] < k || participant_freq[i] > l) {
-            quitf(_wa, "Frequency for tower %d is outside the valid range [%d, %d]", i, k, l);
-        }
+    if (range_bad_tower != 0) {
+        quitf(_wa, "Frequency for tower %d is outside the valid range [%d, %d]", range_bad_tower, k, l);
     }
 
     // Check 2: Verify that each tower's frequency was changed by at most +/-1
-    int actual_changes = 0;
-    for (int i = 1; i <= n; i++) {
-        int diff = abs(participant_freq[i] - initial_freq[i]);
-        if (diff > 1) {
-            quitf(_wa, "Tower %d frequency was changed by %d, which exceeds the allowed +/-1", i, diff);
-        }
-        if (diff > 0) {
-            actual_changes++;
-        }
+    if (diff_bad_tower != 0) {
+        quitf(_wa, "Tower %d frequency was changed by %d, which exceeds the allowed +/-1",
+              diff_bad_tower, abs(participant_freq[diff_bad_tower] - initial_freq[diff_bad_tower - 1]));
     }
 
     // Check 3: Verify that the reported number of changes matches the actual changes
@@ -116,7 +100,7 @@ int main(int argc, char *argv[]) {
     }
 
     // Check 4: Verify that there are no frequency conflicts among connected towers
-    if (hasConflicts(participant_freq, adj)) {
+    if (participant_conflicts) {
         quitf(_wa, "Solution still has frequency conflicts");
     }
 
@@ -1,102 +1,164 @@
 #include "testlib.h"
+#include "treegen.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <string>
-#include <queue>
-#include <set>
-#include <map>
-#include <random>
 #include <cassert>
 
 using namespace std;
 
-// Generate a tree of n vertices with the specified type
-vector<pair<int, int>> generateTree(int n, const string& type) {
-    vector<pair<int, int>> edges;
-    
+// The generator pipeline works on one flat edge buffer of 2 * (n - 1) ints:
+// edge i is (edges[2 * i], edges[2 * i + 1]). Every stage below reads or rewrites it in place.
+
+// Generate a tree of n vertices with the specified type into edges.
+// Shapes from treegen.h take an optional parameter after a colon, e.g. "kary:3", "broom:1000", "deep:20".
+void generateTree(int n, const string& type, vector<int>& edges) {
+    edges.assign(2 * max(n - 1, 0), 0);
+    size_t e = 0;
+    auto addEdge = [&](int u, int v) {
+        edges[e++] = u;
+        edges[e++] = v;
+    };
+
+    string shape = type;
+    int param = 0;
+    bool hasParam = false;
+    size_t colon = type.find(':');
+    if (colon != string::npos) {
+        shape = type.substr(0, colon);
+        param = stoi(type.substr(colon + 1));
+        hasParam = true;
+    }
+
+    vector<int> parent;
+    if (shape == "prufer") {
+        // Uniformly random labeled tree, unlike "random" its depth is around sqrt(n)
+        parent = randomTree(n);
+    } else if (shape == "kary") {
+        parent = karyTree(n, hasParam ? param : 3);
+    } else if (shape == "caterpillar") {
+        parent = caterpillarTree(n, hasParam ? param : (n + 1) / 2);
+    } else if (shape == "broom") {
+        parent = broomTree(n, hasParam ? param : (n + 1) / 2);
+    } else if (shape == "bushes") {
+        // Path over half of the vertices, the rest in bushes of up to param vertices
+        parent = pathWithBushesTree(n, (n + 1) / 2, hasParam ? param : 10);
+    } else if (shape == "deep") {
+        parent = wnextTree(n, hasParam ? param : 10);
+    }
+    if (!parent.empty()) {
+        for (int v = 1; v <= n; v++) {
+            if (parent[v] != 0) {
+                addEdge(parent[v], v);
+            }
+        }
+        return;
+    }
+
     if (type == "star") {
         // Star tree: one central node connected to all others
         for (int i = 2; i <= n; i++) {
-            edges.push_back({1, i});
+            addEdge(1, i);
         }
     } else if (type == "line") {
         // Line tree: vertices in a single line
         for (int i = 1; i < n; i++) {
-            edges.push_back({i, i + 1});
+            addEdge(i, i + 1);
         }
     } else if (type == "binary") {
         // Binary tree: each node has at most 2 children
         for (int i = 2; i <= n; i++) {
             int parent = (i / 2);
-            edges.push_back({parent, i});
+            addEdge(parent, i);
         }
     } else if (type == "random") {
         for (int i = 2; i <= n; i++) {
             int j = rnd.next(1, i - 1);
-            edges.push_back({j, i});
+            addEdge(j, i);
         }
     } else {
         throw runtime_error("Unknown tree type: " + type);
     }
-    
-    return edges;
 }
 
 // Shuffle the vertices of the tree
-vector<pair<int, int>> shuffleTree(const vector<pair<int, int>>& tree, int n) {
+void shuffleTree(vector<int>& edges, int n) {
     vector<int> perm(n + 1);
     for (int i = 1; i <= n; i++) {
         perm[i] = i;
     }
-    
+
     shuffle(perm.begin() + 1, perm.end());
-    
-    vector<pair<int, int>> shuffled_tree;
-    for (auto [u, v] : tree) {
-        shuffled_tree.push_back({perm[u], perm[v]});
+
+    for (int& v : edges) {
+        v = perm[v];
+    }
+}
+
+// Shuffle the order of the edges and the order of the endpoints of each edge
+void shuffleEdges(vector<int>& edges) {
+    int m = int(edges.size() / 2);
+    for (int i = m - 1; i > 0; i--) {
+        int j = rnd.next(0, i);
+        swap(edges[2 * i], edges[2 * j]);
+        swap(edges[2 * i + 1], edges[2 * j + 1]);
+    }
+    for (int i = 0; i < m; i++) {
+        if (rnd.next(0, 1) == 1) {
+            swap(edges[2 * i], edges[2 * i + 1]);
+        }
     }
-    
-    return shuffled_tree;
 }
 
 // Assign frequencies to vertices
-vector<int> assignFrequencies(int n, int l, int r, const string& way, const vector<pair<int, int>>& tree) {
+vector<int> assignFrequencies(int n, int l, int r, const string& way, const vector<int>& edges) {
     vector<int> frequencies(n + 1);
-    
+
     if (way == "random") {
         // Random frequencies in range [l, r]
         for (int i = 1; i <= n; i++) {
             frequencies[i] = rnd.next(l, r);
         }
     } else if (way == "walk") {
-        // Incremental walk algorithm
-        vector<vector<int>> adj(n + 1);
-        for (auto [u, v] : tree) {
-            adj[u].push_back(v);
-            adj[v].push_back(u);
+        // Incremental walk algorithm, a BFS over the adjacency lists in CSR form:
+        // the neighbours of u are adj[start[u]..start[u + 1]), in edge order
+        vector<int> start(n + 2, 0);
+        for (int v : edges) {
+            start[v]++;
+        }
+        for (int u = 1; u <= n + 1; u++) {
+            start[u] += start[u - 1];
+        }
+        // start[u] is the end of u's list, filling backwards moves it to the beginning
+        vector<int> adj(edges.size());
+        for (size_t i = edges.size(); i > 0; i -= 2) {
+            int u = edges[i - 2], v = edges[i - 1];
+            adj[--start[v]] = u;
+            adj[--start[u]] = v;
         }
-        
+
         vector<bool> visited(n + 1, false);
-        queue<int> q;
-        
+        vector<int> queue(n);
+        int head = 0, tail = 0;
+
         // Start from a random vertex with random frequency
-        int start = rnd.next(1, n);
-        frequencies[start] = rnd.next(l, r);
-        visited[start] = true;
-        q.push(start);
-        
+        int start_vertex = rnd.next(1, n);
+        frequencies[start_vertex] = rnd.next(l, r);
+        visited[start_vertex] = true;
+        queue[tail++] = start_vertex;
+
         // Random direction (increment or decrement)
         bool increment = rnd.next(0, 1) == 1;
-        
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-            
-            for (int v : adj[u]) {
+
+        while (head < tail) {
+            int u = queue[head++];
+
+            for (int k = start[u]; k < start[u + 1]; k++) {
+                int v = adj[k];
                 if (!visited[v]) {
                     visited[v] = true;
-                    
+
                     // Determine next frequency
                     if (increment) {
                         frequencies[v] = frequencies[u] + 1;
@@ -111,8 +173,8 @@ vector<int> assignFrequencies(int n, int l, int r, const string& way, const vect
                             increment = true;
                         }
                     }
-                    
-                    q.push(v);
+
+                    queue[tail++] = v;
                 }
             }
         }
@@ -125,13 +187,13 @@ vector<int> assignFrequencies(int n, int l, int r, const string& way, const vect
     } else {
         throw runtime_error("Unknown frequency assignment method: " + way);
     }
-    
+
     return frequencies;
 }
 
 int main(int argc, char* argv[]) {
-    registerGen(argc, argv, 1);
-    
+    registerGen(argc, argv, 1, true);
+
     // Parse command line arguments
     int n = atoi(argv[1]);  // Number of vertices
     int l = atoi(argv[2]);  // Min frequency
@@ -140,28 +202,29 @@ int main(int argc, char* argv[]) {
     string freq_way = argv[5];   // Way to assign frequencies
     int L = atoi(argv[6]); // lower bound on frequency
     int R = atoi(argv[7]); // upper bound on frequency
+    bool shuffle_edges = opt<bool>("shuffle-edges", false);  // -shuffle-edges=true also shuffles the edge order
+
 
-    
     // Generate tree
-    vector<pair<int, int>> tree = generateTree(n, tree_type);
-    
+    vector<int> edges;
+    generateTree(n, tree_type, edges);
+
     // Shuffle vertices
-    tree = shuffleTree(tree, n);
-    
+    shuffleTree(edges, n);
+    if (shuffle_edges) {
+        shuffleEdges(edges);
+    }
+
     // Assign frequencies
-    vector<int> frequencies = assignFrequencies(n, l, r, freq_way, tree);
+    vector<int> frequencies = assignFrequencies(n, l, r, freq_way, edges);
 
     cout<<n<<" "<<L<<" "<<R<<endl;
-    
+
     // Output frequencies
-    for (int i = 1; i <= n; i++) {
-        cout << frequencies[i] << (i < n ? " " : "\n");
-    }
-    
+    gout.writeInts(frequencies.begin() + 1, frequencies.end());
+
     // Output edges
-    for (auto [u, v] : tree) {
-        cout << u << " " << v << endl;
-    }
-    
+    gout.writeFlatEdges(edges);
+
     return 0;
 }
@@ -0,0 +1,22 @@
+#pragma once
+// Input layout of radiotorni, shared by checker.cpp and validator.cpp (see schema in testlib.h)
+#include "testlib.h"
+
+const int MAXN = 500'000;
+const int MAXL = 1'000'000'000;
+
+namespace radiotorni {
+
+constexpr char N[] = "N", K[] = "K", L[] = "L", f[] = "fi", edge[] = "edge", u[] = "u", v[] = "v";
+
+// N K L
+// f1 f2 ... fN          frequencies in [K, L]
+// u v                   N-1 edges between towers 1..N
+using Input = schema::Schema<
+    schema::Line<schema::Int<N, schema::Val<2>, schema::Val<MAXN>>,
+                 schema::Int<K, schema::Val<1>, schema::Val<MAXL>>,
+                 schema::Int<L, schema::Var<K, 1>, schema::Val<MAXL>>>,
+    schema::Line<schema::Ints<f, schema::Var<N>, schema::Var<K>, schema::Var<L>>>,
+    schema::Edges<edge, u, v, schema::Var<N, -1>, schema::Val<1>, schema::Var<N>>>;
+
+} // namespace radiotorni
@@ -63,6 +63,17 @@
  */
 
 const char *latestFeatures[] = {
+        "Added input schemas (C++17, namespace schema): the input layout as a type like Schema<Line<Int<N, Val<2>, Val<MAXN>>>, Line<Ints<f, Var<N>, Val<1>, Var<K>>>, Edges<e, u, v, Var<N, -1>, Val<1>, Var<N>>>, read strictly by validators and token-wise by checkers",
+        "Added generator multigen mode (gen --multigen <manifest>): one registered generator writes a test per \"<output-file>\\t<arg>...\" line, each seeded like a separate run with those arguments",
+        "Added validator batch mode (validator --batch): validates every \"<input-file>\\t<group>\" line of stdin in one process, prints a JSON verdict per file and bounds/feature coverage per group",
+        "Added read profiling with -DTESTLIB_PROFILE: bytes, tokens and refills per stream and cycles per phase, printed at exit",
+        "Added random generator version 2 (registerGen(argc, argv, 2)): xoshiro256** engine, rnd.fill(first, last, from, to) fills a range with random values",
+        "Added gout.writeFlatEdges for edge lists stored as one flat array u1 v1 u2 v2 ...",
+        "Added --verdict-json <file> for checkers, the JSON verdict includes checker time and peak memory",
+        "Added checker server mode (checker --server) that returns JSON verdicts, call checker.inputRead() after reading inf to parse every input only once",
+        "Added buffered generator output gout (gout.write, gout.writeInts, gout.writeEdges), registerGen(argc, argv, 1, true) makes cout use it",
+        "Added inf.readIntsTo(ptr_or_vector, size[, minv, maxv, name]) to read integers into caller-owned storage, readInts uses it",
+        "Regular input files are read through MmapInputStreamReader (define TESTLIB_NO_MMAP to disable), tokens are scanned in place",
         "Added ConstantBoundsLog, VariablesLog to validator testOverviewLogFile",
         "Use setAppesModeEncoding to change xml encoding from windows-1251 to other",
         "rnd.any/wany use distance/advance instead of -/+: now they support sets/multisets",
@@ -211,6 +222,13 @@ const char *latestFeatures[] = {
 #else
 #   define WORD unsigned short
 #   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <sys/wait.h>
+#   include <sys/resource.h>
+#   include <signal.h>
+#   include <time.h>
+#   include <errno.h>
 #endif
 
 #if defined(FOR_WINDOWS) && defined(FOR_LINUX)
@@ -771,7 +789,73 @@ private:
     static const unsigned long long mask;
     static const int lim;
 
+    /* State of the xoshiro256** engine, used instead of the LCG when version == 2. */
+    unsigned long long xs[4];
+
+    static unsigned long long rotl(unsigned long long x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    static unsigned long long splitmix64(unsigned long long &x) {
+        unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static unsigned long long xoshiroNext(unsigned long long *s) {
+        unsigned long long result = rotl(s[1] * 5, 7) * 9;
+        unsigned long long t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /* Seeds the xoshiro256** state from the LCG seed, so both engines are seeded by the same arguments. */
+    void seedXoshiro() {
+        unsigned long long x = seed;
+        for (int i = 0; i < 4; i++)
+            xs[i] = splitmix64(x);
+    }
+
+    /*
+     * Value in [0, n) from the 64-bit engine output x, n > 0: the high half of x * n (Lemire's method).
+     * Results with the low half below 2^64 mod n are rejected so the distribution stays exactly uniform.
+     */
+    static unsigned long long boundedFrom(unsigned long long x, unsigned long long n, unsigned long long *s) {
+#ifdef __SIZEOF_INT128__
+        unsigned __int128 m = (unsigned __int128) x * n;
+        unsigned long long low = (unsigned long long) m;
+        if (low < n) {
+            unsigned long long threshold = (0 - n) % n;
+            while (low < threshold) {
+                m = (unsigned __int128) xoshiroNext(s) * n;
+                low = (unsigned long long) m;
+            }
+        }
+        return (unsigned long long) (m >> 64);
+#else
+        const unsigned long long limit = (0 - n) % n;
+        while (x < limit)
+            x = xoshiroNext(s);
+        return x % n;
+#endif
+    }
+
     long long nextBits(int bits) {
+        if (version == 2) {
+            if (bits > 63)
+                __testlib_fail("random_t::nextBits(int bits): n must be less than 64");
+            // A shift by 64 is undefined, zero bits are 0 as in version 1
+            if (bits <= 0)
+                return 0;
+            return (long long) (xoshiroNext(xs) >> (64 - bits));
+        }
+
         if (bits <= 48) {
             seed = (seed * multiplier + addend) & mask;
             return (long long) (seed >> (48 - bits));
@@ -794,6 +878,7 @@ public:
     /* New random_t with fixed seed. */
     random_t()
             : seed(3905348978240129619LL) {
+        seedXoshiro();
     }
 
     /* Sets seed by command line. */
@@ -809,12 +894,14 @@ public:
         }
 
         seed = seed & mask;
+        seedXoshiro();
     }
 
     /* Sets seed by given value. */
     void setSeed(long long _seed) {
         seed = (unsigned long long) _seed;
         seed = (seed ^ multiplier) & mask;
+        seedXoshiro();
     }
 
 #ifndef __BORLANDC__
@@ -839,6 +926,9 @@ public:
         if (n <= 0)
             __testlib_fail("random_t::next(int n): n must be positive");
 
+        if (version == 2)
+            return int(boundedFrom(xoshiroNext(xs), (unsigned long long) n, xs));
+
         if ((n & -n) == n)  // n is a power of 2
             return (int) ((n * (long long) nextBits(31)) >> 31);
 
@@ -864,6 +954,9 @@ public:
         if (n <= 0)
             __testlib_fail("random_t::next(long long n): n must be positive");
 
+        if (version == 2)
+            return (long long) boundedFrom(xoshiroNext(xs), (unsigned long long) n, xs);
+
         const long long limit = __TESTLIB_LONGLONG_MAX / n * n;
 
         long long bits;
@@ -927,6 +1020,44 @@ public:
         return next(to - from + 1) + from;
     }
 
+    /*
+     * Fills [first, last) with random values in range [from, to], the same values as "*it = next(from, to)"
+     * for each element, so replacing such a loop by fill doesn't change the test.
+     * With version 2 the engine state stays in registers for the whole loop, which is the fast way
+     * to generate millions of values. Version 2 also accepts the full 64-bit range.
+     */
+    template<typename Iterator, typename T>
+    void fill(Iterator first, Iterator last, T from, T to) {
+        if (from > to)
+            __testlib_fail("random_t::fill(first, last, from, to): from can't exceed to");
+        if (version != 2) {
+            for (Iterator i = first; i != last; i++)
+                *i = next(from, to);
+        } else
+            fillXoshiro(first, last, from, to);
+    }
+
+private:
+    template<typename Iterator, typename T>
+    void fillXoshiro(Iterator first, Iterator last, T from, T to) {
+        unsigned long long n = (unsigned long long) to - (unsigned long long) from + 1;
+        // A local copy of the state stays in registers, stores through the iterator can't alias it
+        unsigned long long s[4] = {xs[0], xs[1], xs[2], xs[3]};
+        for (Iterator i = first; i != last; i++) {
+            unsigned long long x = xoshiroNext(s);
+            // n == 0 is the full 64-bit range
+            *i = T(n == 0 ? x : (unsigned long long) from + boundedFrom(x, n, s));
+        }
+        for (int k = 0; k < 4; k++)
+            xs[k] = s[k];
+    }
+
+public:
+    template<typename Container, typename T>
+    void fill(Container &c, T from, T to) {
+        fill(c.begin(), c.end(), from, to);
+    }
+
     /* Random double value in range [0, 1). */
     double next() {
         long long left = ((long long) (nextBits(26)) << 27);
@@ -1681,8 +1812,88 @@ const std::string outcomes[] = {
         "partially-correct"
 };
 
+/*
+ * Read profiling, compiled in with -DTESTLIB_PROFILE (without it the macros below expand to nothing).
+ * Counts bytes, tokens and refills per stream and the time spent in each phase of reading, the totals
+ * are printed to stderr at exit (quit() or the end of a validator) and added to the JSON verdict.
+ * Time is measured in TSC cycles on x86, in nanoseconds elsewhere.
+ */
+#ifdef TESTLIB_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#   define __TESTLIB_PROFILE_UNIT "cycles"
+#elif defined(_MSC_VER)
+#   include <intrin.h>
+#   define __TESTLIB_PROFILE_UNIT "cycles"
+#else
+#   define __TESTLIB_PROFILE_UNIT "ns"
+#endif
+
+enum __testlib_profilePhase {
+    __TESTLIB_PROFILE_IO,       // file reads (refill) and mapping
+    __TESTLIB_PROFILE_TOKENIZE, // readWordTo
+    __TESTLIB_PROFILE_CONVERT,  // token to number
+    __TESTLIB_PROFILE_SCAN_INT, // fused tokenize and convert of mapped int32 (readIntsTo)
+    __TESTLIB_PROFILE_BOUNDS,   // validator bookkeeping: addBoundsHit, adjustConstantBounds
+    __TESTLIB_PROFILE_PHASES
+};
+
+static const char *__testlib_profilePhaseNames[__TESTLIB_PROFILE_PHASES] = {
+        "io", "tokenize", "convert", "scan_int", "bounds"
+};
+
+static unsigned long long __testlib_profileTime[__TESTLIB_PROFILE_PHASES];
+static unsigned long long __testlib_profileCalls[__TESTLIB_PROFILE_PHASES];
+
+static inline unsigned long long __testlib_profileClock() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_MSC_VER)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + (unsigned long long) now.tv_nsec;
+#endif
+}
+
+/* Adds the time from construction to destruction to the phase. */
+struct __testlib_profileScope {
+    int phase;
+    unsigned long long start;
+
+    explicit __testlib_profileScope(int phase) : phase(phase), start(__testlib_profileClock()) {
+    }
+
+    ~__testlib_profileScope() {
+        __testlib_profileTime[phase] += __testlib_profileClock() - start;
+        __testlib_profileCalls[phase]++;
+    }
+};
+
+struct __testlib_streamProfile {
+    unsigned long long bytes, tokens, refills;
+
+    __testlib_streamProfile() : bytes(0), tokens(0), refills(0) {
+    }
+};
+
+#   define __TESTLIB_PROFILE_SCOPE(phase) __testlib_profileScope __testlib_profileScopeInstance(phase)
+#   define __TESTLIB_PROFILE_COUNT(profile, field, n) do { if (NULL != (profile)) (profile)->field += (n); } while (false)
+#else
+#   define __TESTLIB_PROFILE_SCOPE(phase)
+#   define __TESTLIB_PROFILE_COUNT(profile, field, n) do {} while (false)
+#endif
+
 class InputStreamReader {
 public:
+#ifdef TESTLIB_PROFILE
+    /* Counters of the InStream reading from this reader, NULL if there is none. */
+    __testlib_streamProfile *profile;
+
+    InputStreamReader() : profile(NULL) {
+    }
+#endif
+
+
     virtual void setTestCase(int testCase) = 0;
 
     virtual std::vector<int> getReadChars() = 0;
@@ -1794,6 +2005,8 @@ private:
 
         if (undoChars.empty()) {
             c = rc = ::getc(file);
+            if (c != EOF)
+                __TESTLIB_PROFILE_COUNT(profile, bytes, 1);
         } else {
             c = undoChars.back();
             undoChars.pop_back();
@@ -1906,6 +2119,7 @@ private:
             __testlib_fail("BufferedFileInputStreamReader: file == NULL (" + getName() + ")");
 
         if (bufferPos >= int(bufferSize)) {
+            __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_IO);
             size_t readSize = fread(
                     buffer + MAX_UNREAD_COUNT,
                     1,
@@ -1920,6 +2134,8 @@ private:
             bufferSize = MAX_UNREAD_COUNT + readSize;
             bufferPos = int(MAX_UNREAD_COUNT);
             std::memset(isEof + MAX_UNREAD_COUNT, 0, sizeof(isEof[0]) * readSize);
+            __TESTLIB_PROFILE_COUNT(profile, bytes, readSize);
+            __TESTLIB_PROFILE_COUNT(profile, refills, 1);
 
             return readSize > 0;
         } else
@@ -2011,6 +2227,153 @@ public:
 const size_t BufferedFileInputStreamReader::BUFFER_SIZE = 2000000;
 const size_t BufferedFileInputStreamReader::MAX_UNREAD_COUNT = BufferedFileInputStreamReader::BUFFER_SIZE / 2;
 
+/*
+ * Reader over a read-only regular file mapped into memory. There is no intermediate
+ * buffer: InStream scans tokens directly from the mapped bytes (see cursor()/limit()/advanceTo()).
+ * Use MmapInputStreamReader::open, it returns NULL for pipes, terminals, empty files
+ * or if mapping is not supported (Windows or TESTLIB_NO_MMAP is defined).
+ */
+class MmapInputStreamReader : public InputStreamReader {
+private:
+    std::FILE *file;
+    std::string name;
+    int line;
+
+    char *data;
+    size_t size;
+    size_t pos;
+
+    MmapInputStreamReader(std::FILE *file, const std::string &name, char *data, size_t size, size_t pos)
+            : file(file), name(name), line(1), data(data), size(size), pos(pos) {
+        // No operations.
+    }
+
+    void unmap() {
+        if (NULL != data) {
+#if !defined(ON_WINDOWS) && !defined(TESTLIB_NO_MMAP)
+            munmap(data, size);
+#endif
+            data = NULL;
+            size = 0;
+            pos = 0;
+        }
+    }
+
+public:
+    static MmapInputStreamReader *open(std::FILE *file, const std::string &name) {
+#if !defined(ON_WINDOWS) && !defined(TESTLIB_NO_MMAP)
+        if (NULL == file)
+            return NULL;
+
+        int fd = fileno(file);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+            return NULL;
+
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0 || offset > st.st_size)
+            return NULL;
+
+        // Private writable mapping: the file itself is never modified, but unreadChar()
+        // may put back a character different from the one in the file.
+        void *mapped = mmap(NULL, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == mapped)
+            return NULL;
+#ifdef MADV_SEQUENTIAL
+        madvise(mapped, size_t(st.st_size), MADV_SEQUENTIAL);
+#endif
+
+        return new MmapInputStreamReader(file, name, static_cast<char *>(mapped), size_t(st.st_size), size_t(offset));
+#else
+        (void) file;
+        (void) name;
+        return NULL;
+#endif
+    }
+
+    ~MmapInputStreamReader() {
+        unmap();
+    }
+
+    /* Unread characters are [cursor(), limit()). */
+    inline const char *cursor() const {
+        return data + (pos < size ? pos : size);
+    }
+
+    inline const char *limit() const {
+        return data + size;
+    }
+
+    /* Moves the cursor to p (inside [cursor(), limit()]), lineFeeds is the number of LF skipped. */
+    inline void advanceTo(const char *p, int lineFeeds) {
+        pos = size_t(p - data);
+        line += lineFeeds;
+    }
+
+    inline int lineNumber() const {
+        return line;
+    }
+
+    void setTestCase(int) {
+        __testlib_fail("setTestCase not implemented in MmapInputStreamReader");
+    }
+
+    std::vector<int> getReadChars() {
+        __testlib_fail("getReadChars not implemented in MmapInputStreamReader");
+    }
+
+    int curChar() {
+        return pos < size ? data[pos] : EOFC;
+    }
+
+    int nextChar() {
+        if (pos >= size) {
+            pos++;
+            return EOFC;
+        }
+        char c = data[pos++];
+        if (c == LF)
+            line++;
+        return c;
+    }
+
+    void skipChar() {
+        nextChar();
+    }
+
+    void unreadChar(int c) {
+        if (pos == 0)
+            __testlib_fail("MmapInputStreamReader::unreadChar(int): pos == 0.");
+        pos--;
+        if (pos < size) {
+            if (data[pos] != char(c))
+                data[pos] = char(c);
+            if (c == LF)
+                line--;
+        }
+    }
+
+    std::string getName() {
+        return name;
+    }
+
+    int getLine() {
+        return line;
+    }
+
+    bool eof() {
+        return pos >= size;
+    }
+
+    void close() {
+        unmap();
+        if (NULL != file) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+};
+
 /*
  * Streams to be used for reading data in checkers or validators.
  * Each read*() method moves pointer to the next character after the
@@ -2026,6 +2389,20 @@ struct InStream {
     InStream(const InStream &baseStream, std::string content);
 
     InputStreamReader *reader;
+#ifdef TESTLIB_PROFILE
+    /* Read counters of this stream, see TESTLIB_PROFILE. */
+    __testlib_streamProfile profile;
+
+    /* Connects the counters to a new reader, a mapped stream counts its whole unread span as read. */
+    void attachProfile() {
+        if (NULL != reader)
+            reader->profile = &profile;
+        if (NULL != mappedReader)
+            profile.bytes += (unsigned long long) (mappedReader->limit() - mappedReader->cursor());
+    }
+#endif
+    /* Equals to reader if the stream is mapped into memory, NULL otherwise. */
+    MmapInputStreamReader *mappedReader;
     int lastLine;
 
     std::string name;
@@ -2046,6 +2423,12 @@ struct InStream {
 
     void init(std::FILE *f, TMode mode);
 
+    /*
+     * Replaces the reader of a standard stream with MmapInputStreamReader if the
+     * stream is redirected from a regular file. Call it before reading anything.
+     */
+    void mapStdfile(std::FILE *f);
+
     void setTestCase(int testCase);
     std::vector<int> getReadChars();
 
@@ -2206,6 +2589,21 @@ struct InStream {
     /* Reads space-separated sequence of integers. */
     std::vector<int> readInts(int size, int indexBase = 1);
 
+    /*
+     * As "readInts()" but stores the integers into the caller-owned storage.
+     * Values are parsed in one loop (directly from memory for mapped files),
+     * validator bounds statistics are updated once per call instead of once per element.
+     */
+    void readIntsTo(int *result, int size, int minv, int maxv, const std::string &variablesName = "", int indexBase = 1);
+
+    void readIntsTo(int *result, int size, int indexBase = 1);
+
+    /* As above, resizes result to size. */
+    void readIntsTo(std::vector<int> &result, int size, int minv, int maxv, const std::string &variablesName = "",
+                    int indexBase = 1);
+
+    void readIntsTo(std::vector<int> &result, int size, int indexBase = 1);
+
     /*
      * Reads new double. Ignores white-spaces into the non-strict mode
      * (strict mode is used in validators usually).
@@ -2387,6 +2785,17 @@ private:
     InStream(const InStream &);
 
     InStream &operator=(const InStream &);
+
+    /* Fast path of readWordTo() for mapped streams: finds the next token in place. */
+    void scanMappedToken(const char *&tokenBegin, const char *&tokenEnd);
+
+    /*
+     * Fast path of readInt() for mapped streams. Parses only well-formed int32 tokens,
+     * returns false without moving the stream pointer otherwise.
+     */
+    bool scanMappedInt(int &value);
+
+    NORETURN void quitIntRange(int value, int minv, int maxv, const std::string &variableName);
 };
 
 InStream inf;
@@ -2399,6 +2808,8 @@ std::string checkerName = "untitled checker";
 random_t rnd;
 TTestlibMode testlibMode = _unknown;
 double __testlib_points = std::numeric_limits<float>::infinity();
+/* quit() writes the verdict as a JSON line to this descriptor (checker --verdict-json or --server). */
+int __testlib_verdictFd = -1;
 
 const size_t VALIDATOR_MAX_VARIABLE_COUNT = 255;
 
@@ -2566,6 +2977,7 @@ public:
     }
 
     void addBoundsHit(const std::string &variableName, ValidatorBoundsHit boundsHit) {
+        __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_BOUNDS);
         if (isVariableNameBoundsAnalyzable(variableName)
                 && _boundsHitByVariableName.size() < VALIDATOR_MAX_VARIABLE_COUNT) {
             std::string preparedVariableName = prepVariableName(variableName);
@@ -2591,6 +3003,7 @@ public:
 
     template<typename T>
     void adjustConstantBounds(const std::string &variableName, T lower, T upper) {
+        __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_BOUNDS);
         if (isVariableNameBoundsAnalyzable(variableName)
                 && _constantBoundsByVariableName.size() < VALIDATOR_MAX_VARIABLE_COUNT) {
             std::string preparedVariableName = prepVariableName(variableName);
@@ -2648,6 +3061,10 @@ public:
         return result;
     }
 
+    std::string getTestOverviewLog() {
+        return getBoundsHitLog() + getFeaturesLog() + getConstantBoundsLog() + getVariablesLog();
+    }
+
     void writeTestOverviewLog() {
         if (!_testOverviewLogFileName.empty()) {
             std::string fileName(_testOverviewLogFileName);
@@ -2664,11 +3081,7 @@ public:
                 if (NULL == f)
                     __testlib_fail("Validator::writeTestOverviewLog: can't write test overview log to (" + fileName + ")");
             }
-            fprintf(f, "%s%s%s%s",
-                getBoundsHitLog().c_str(),
-                getFeaturesLog().c_str(),
-                getConstantBoundsLog().c_str(),
-                getVariablesLog().c_str());
+            fprintf(f, "%s", getTestOverviewLog().c_str());
             std::fflush(f);
             if (!standard_file)
                 if (std::fclose(f))
@@ -2788,6 +3201,52 @@ const std::string Validator::TEST_MARKUP_HEADER = "MU\xF3\x01";
 const std::string Validator::TEST_CASE_OPEN_TAG = "!c";
 const std::string Validator::TEST_CASE_CLOSE_TAG = ";";
 
+#ifdef TESTLIB_PROFILE
+static bool __testlib_profileDumped = false;
+
+/* The read profile as a JSON object: {"unit": ..., "streams": {"inf": {...}, ...}, "phases": {"io": {...}, ...}} */
+static std::string __testlib_profileJson() {
+    const char *names[] = {"inf", "ouf", "ans"};
+    InStream *streams[] = {&inf, &ouf, &ans};
+    std::string json = "{\"unit\": \"" + std::string(__TESTLIB_PROFILE_UNIT) + "\", \"streams\": {";
+    for (int i = 0; i < 3; i++)
+        json += testlib_format_("%s\"%s\": {\"bytes\": %llu, \"tokens\": %llu, \"refills\": %llu, \"mapped\": %s}",
+                                i > 0 ? ", " : "", names[i], streams[i]->profile.bytes, streams[i]->profile.tokens,
+                                streams[i]->profile.refills, NULL != streams[i]->mappedReader ? "true" : "false");
+    json += "}, \"phases\": {";
+    for (int i = 0; i < __TESTLIB_PROFILE_PHASES; i++)
+        json += testlib_format_("%s\"%s\": {\"calls\": %llu, \"time\": %llu}", i > 0 ? ", " : "",
+                                __testlib_profilePhaseNames[i], __testlib_profileCalls[i], __testlib_profileTime[i]);
+    return json + "}}";
+}
+
+/* Prints the read profile to stderr, once. */
+static void __testlib_profileDump() {
+    if (__testlib_profileDumped)
+        return;
+    __testlib_profileDumped = true;
+
+    const char *names[] = {"inf", "ouf", "ans"};
+    InStream *streams[] = {&inf, &ouf, &ans};
+    if (inf.profile.bytes == 0 && ouf.profile.bytes == 0 && ans.profile.bytes == 0)
+        return; // Nothing was read, e.g. in generators
+    std::fprintf(stderr, "testlib profile (time in %s):\n", __TESTLIB_PROFILE_UNIT);
+    for (int i = 0; i < 3; i++)
+        if (streams[i]->profile.bytes > 0 || streams[i]->profile.tokens > 0)
+            std::fprintf(stderr, "    %s: %llu bytes, %llu tokens, %llu refills%s\n", names[i],
+                         streams[i]->profile.bytes, streams[i]->profile.tokens, streams[i]->profile.refills,
+                         NULL != streams[i]->mappedReader ? ", mapped" : "");
+    for (int i = 0; i < __TESTLIB_PROFILE_PHASES; i++)
+        if (__testlib_profileCalls[i] > 0)
+            std::fprintf(stderr, "    %-8s %12llu calls %16llu %s\n", __testlib_profilePhaseNames[i],
+                         __testlib_profileCalls[i], __testlib_profileTime[i], __TESTLIB_PROFILE_UNIT);
+}
+#endif
+
+#ifndef ON_WINDOWS
+static void __testlib_writeBatchVerdict();
+#endif
+
 struct TestlibFinalizeGuard {
     static bool alive;
     static bool registered;
@@ -2816,7 +3275,15 @@ struct TestlibFinalizeGuard {
                 __testlib_fail("Call register-function in the first line of the main (registerTestlibCmd or other similar)");
         }
 
+#ifdef TESTLIB_PROFILE
+        __testlib_profileDump();
+#endif
+
         if (__testlib_exitCode == 0) {
+#ifndef ON_WINDOWS
+            if (testlibMode == _validator && __testlib_verdictFd >= 0)
+                __testlib_writeBatchVerdict();
+#endif
             validator.writeTestOverviewLog();
             validator.writeTestMarkup();
             validator.writeTestCase();
@@ -2848,6 +3315,7 @@ std::fstream tout;
 
 InStream::InStream() {
     reader = NULL;
+    mappedReader = NULL;
     lastLine = -1;
     opened = false;
     name = "";
@@ -2863,6 +3331,7 @@ InStream::InStream() {
 
 InStream::InStream(const InStream &baseStream, std::string content) {
     reader = new StringInputStreamReader(content);
+    mappedReader = NULL;
     lastLine = -1;
     opened = true;
     strict = baseStream.strict;
@@ -3064,6 +3533,105 @@ static std::string __testlib_toPrintableMessage(const std::string &message) {
     return message;
 }
 
+static std::string __testlib_jsonEscape(const std::string &s) {
+    std::string result;
+    result.reserve(s.length() + 2);
+    for (size_t i = 0; i < s.length(); i++) {
+        unsigned char c = (unsigned char) s[i];
+        if (c == '"' || c == '\\')
+            result += '\\', result += char(c);
+        else if (c == '\n')
+            result += "\\n";
+        else if (c == '\r')
+            result += "\\r";
+        else if (c == '\t')
+            result += "\\t";
+        else if (c < 0x20)
+            result += testlib_format_("\\u%04x", int(c));
+        else
+            result += char(c);
+    }
+    return result;
+}
+
+/*
+ * Verdict as a JSON object on one line: {"verdict": "WA", "exit_code": 1, "message": "..."}.
+ * The verdict is one of OK, WA, PE, FAIL, POINTS, PARTIALLY, UNEXPECTED_EOF.
+ * extraFields (like ", \"points\": 0.5") are inserted before the closing brace.
+ */
+static std::string __testlib_jsonVerdict(const std::string &verdict, int exitCode, const std::string &message,
+                                         const std::string &extraFields = "") {
+    return "{\"verdict\": \"" + verdict + "\", \"exit_code\": " + vtos(exitCode)
+           + ", \"message\": \"" + __testlib_jsonEscape(message) + "\"" + extraFields + "}\n";
+}
+
+static std::string __testlib_verdictName(TResult result, bool isPartial) {
+    if (isPartial)
+        return "PARTIALLY";
+    switch (result) {
+        case _ok:
+            return "OK";
+        case _wa:
+            return "WA";
+        case _pe:
+            return "PE";
+        case _points:
+            return "POINTS";
+        case _unexpected_eof:
+            return "UNEXPECTED_EOF";
+        default:
+            return "FAIL";
+    }
+}
+
+#ifndef ON_WINDOWS
+/* Start of the current check, the JSON verdict reports the checker time since then. */
+static struct timespec __testlib_checkStart;
+
+static void __testlib_startCheckTimer() {
+    clock_gettime(CLOCK_MONOTONIC, &__testlib_checkStart);
+}
+
+/*
+ * Checker cost for the JSON verdict: ", "time": <cpu seconds>, "wall_time": <seconds>, "memory_kib": <peak rss>".
+ * A process forked per check (server mode) starts with zero CPU time, the peak includes the shared parsed input.
+ */
+static std::string __testlib_checkCostFields() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpuTime = double(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+                     + double(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1E6;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double wallTime = double(now.tv_sec - __testlib_checkStart.tv_sec)
+                      + double(now.tv_nsec - __testlib_checkStart.tv_nsec) / 1E9;
+
+    return testlib_format_(", \"time\": %.3f, \"wall_time\": %.3f, \"memory_kib\": %ld",
+                           cpuTime, wallTime, long(usage.ru_maxrss));
+}
+
+static void __testlib_writeAll(int fd, const std::string &data) {
+    size_t written = 0;
+    while (written < data.length()) {
+        ssize_t n = write(fd, data.data() + written, data.length() - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        written += size_t(n);
+    }
+}
+
+/* Validator batch mode: the verdict of a valid file, followed by its test overview log for the per-group coverage. */
+static void __testlib_writeBatchVerdict() {
+    int resultFd = __testlib_verdictFd;
+    __testlib_verdictFd = -1;
+    __testlib_writeAll(resultFd, __testlib_jsonVerdict("OK", 0, "", __testlib_checkCostFields())
+                                 + validator.getTestOverviewLog());
+}
+#endif
+
 NORETURN void InStream::quit(TResult result, const char *msg) {
     if (TestlibFinalizeGuard::alive)
         testlibFinalizeGuard.quitCount++;
@@ -3113,6 +3681,10 @@ NORETURN void InStream::quit(TResult result, const char *msg) {
             quit(_dirt, "Extra information in the output file");
     }
 
+#ifdef TESTLIB_PROFILE
+    __testlib_profileDump();
+#endif
+
     int pctype = result - _partially;
     bool isPartial = false;
 
@@ -3155,6 +3727,24 @@ NORETURN void InStream::quit(TResult result, const char *msg) {
                 quit(_fail, "What is the code ??? ");
     }
 
+#ifndef ON_WINDOWS
+    if (__testlib_verdictFd >= 0) {
+        std::string extraFields;
+        if (isPartial)
+            extraFields = ", \"pctype\": " + vtos(pctype);
+        else if (result == _points)
+            extraFields = ", \"points\": " + removeDoubleTrailingZeroes(testlib_format_("%.10f", __testlib_points));
+        extraFields += __testlib_checkCostFields();
+#ifdef TESTLIB_PROFILE
+        extraFields += ", \"profile\": " + __testlib_profileJson();
+#endif
+        int resultFd = __testlib_verdictFd;
+        __testlib_verdictFd = -1;
+        __testlib_writeAll(resultFd, __testlib_jsonVerdict(__testlib_verdictName(result, isPartial),
+                resultExitCode(result), __testlib_toPrintableMessage(message), extraFields));
+    }
+#endif
+
     if (resultName != "") {
         resultFile = testlib_fopen_(resultName.c_str(), "w");
         if (resultFile == NULL) {
@@ -3285,13 +3875,23 @@ void InStream::reset(std::FILE *file) {
         opened = true;
         __testlib_set_binary(file);
 
+        mappedReader = NULL;
         if (stdfile)
             reader = new FileInputStreamReader(file, name);
-        else
-            reader = new BufferedFileInputStreamReader(file, name);
+        else {
+            __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_IO);
+            if (NULL != (mappedReader = MmapInputStreamReader::open(file, name)))
+                reader = mappedReader;
+            else
+                reader = new BufferedFileInputStreamReader(file, name);
+        }
+#ifdef TESTLIB_PROFILE
+        attachProfile();
+#endif
     } else {
         opened = false;
         reader = NULL;
+        mappedReader = NULL;
     }
 }
 
@@ -3334,6 +3934,28 @@ void InStream::init(std::FILE *f, TMode mode) {
     reset(f);
 }
 
+void InStream::mapStdfile(std::FILE *f) {
+    if (!opened || !stdfile || NULL != mappedReader)
+        return;
+
+    MmapInputStreamReader *mapped;
+    {
+        __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_IO);
+        mapped = MmapInputStreamReader::open(f, name);
+    }
+    if (NULL != mapped) {
+#ifdef TESTLIB_PROFILE
+        // Bytes already read through the stdio reader stay counted
+        profile.bytes -= std::min(profile.bytes, (unsigned long long) (mapped->limit() - mapped->cursor()));
+#endif
+        delete reader;
+        reader = mappedReader = mapped;
+#ifdef TESTLIB_PROFILE
+        attachProfile();
+#endif
+    }
+}
+
 void InStream::skipBom() {
     const std::string utf8Bom = "\xEF\xBB\xBF";
     size_t index = 0;
@@ -3388,6 +4010,19 @@ void InStream::skipChar() {
 }
 
 void InStream::skipBlanks() {
+    if (NULL != mappedReader) {
+        const char *p = mappedReader->cursor();
+        const char *end = mappedReader->limit();
+        int lineFeeds = 0;
+        while (p < end && isBlanks(*p)) {
+            if (*p == LF)
+                lineFeeds++;
+            p++;
+        }
+        mappedReader->advanceTo(p, lineFeeds);
+        return;
+    }
+
     while (isBlanks(reader->curChar()))
         reader->skipChar();
 }
@@ -3397,7 +4032,46 @@ std::string InStream::readWord() {
     return _tmpReadToken;
 }
 
+void InStream::scanMappedToken(const char *&tokenBegin, const char *&tokenEnd) {
+    if (!strict)
+        skipBlanks();
+
+    lastLine = mappedReader->lineNumber();
+    const char *p = mappedReader->cursor();
+    const char *end = mappedReader->limit();
+
+    if (p == end)
+        quit(_unexpected_eof, "Unexpected end of file - token expected");
+
+    if (isBlanks(*p))
+        quit(_pe, "Unexpected white-space - token expected");
+
+    const char *q = p;
+    while (q < end && !isBlanks(*q))
+        q++;
+
+    // You can change maxTokenLength.
+    // Example: 'inf.maxTokenLength = 128 * 1024 * 1024;'.
+    if (size_t(q - p) > maxTokenLength)
+        quitf(_pe, "Length of token exceeds %d, token is '%s...'", int(maxTokenLength),
+              __testlib_part(std::string(p, p + maxTokenLength + 1)).c_str());
+
+    mappedReader->advanceTo(q, 0);
+    tokenBegin = p;
+    tokenEnd = q;
+}
+
 void InStream::readWordTo(std::string &result) {
+    __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_TOKENIZE);
+    __TESTLIB_PROFILE_COUNT(&profile, tokens, 1);
+    if (NULL != mappedReader) {
+        const char *tokenBegin;
+        const char *tokenEnd;
+        scanMappedToken(tokenBegin, tokenEnd);
+        result.assign(tokenBegin, tokenEnd);
+        return;
+    }
+
     if (!strict)
         skipBlanks();
 
@@ -3866,6 +4540,7 @@ int InStream::readInteger() {
 
     readWordTo(_tmpReadToken);
 
+    __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_CONVERT);
     long long value = stringToLongLong(*this, _tmpReadToken);
     if (value < INT_MIN || value > INT_MAX)
         quit(_pe, ("Expected int32, but \"" + __testlib_part(_tmpReadToken) + "\" found").c_str());
@@ -3879,6 +4554,7 @@ long long InStream::readLong() {
 
     readWordTo(_tmpReadToken);
 
+    __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_CONVERT);
     return stringToLongLong(*this, _tmpReadToken);
 }
 
@@ -3888,6 +4564,7 @@ unsigned long long InStream::readUnsignedLong() {
 
     readWordTo(_tmpReadToken);
 
+    __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_CONVERT);
     return stringToUnsignedLongLong(*this, _tmpReadToken);
 }
 
@@ -4024,23 +4701,179 @@ int InStream::readInteger(int minv, int maxv, const std::string &variableName) {
 }
 
 std::vector<int> InStream::readInts(int size, int minv, int maxv, const std::string &variablesName, int indexBase) {
-    if (strict && !variablesName.empty())
-        validator.addVariable(variablesName);
-    __testlib_readMany(readInts, readInt(minv, maxv, variablesName), int, true)
+    std::vector<int> result;
+    readIntsTo(result, size, minv, maxv, variablesName, indexBase);
+    return result;
 }
 
 std::vector<int> InStream::readInts(int size, int indexBase) {
-    __testlib_readMany(readInts, readInt(), int, true)
+    std::vector<int> result;
+    readIntsTo(result, size, indexBase);
+    return result;
 }
 
 std::vector<int> InStream::readIntegers(int size, int minv, int maxv, const std::string &variablesName, int indexBase) {
+    return readInts(size, minv, maxv, variablesName, indexBase);
+}
+
+std::vector<int> InStream::readIntegers(int size, int indexBase) {
+    return readInts(size, indexBase);
+}
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#   define __TESTLIB_SWAR_DIGITS
+#endif
+
+#ifdef __TESTLIB_SWAR_DIGITS
+/*
+ * Parses the leading decimal digits of the 8 bytes at p at once (SWAR).
+ * Returns the number of leading digits (0..8) and stores their value to value.
+ */
+static inline int __testlib_scanDigits8(const char *p, unsigned long long &value) {
+    unsigned long long chunk;
+    std::memcpy(&chunk, p, sizeof(chunk));
+
+    unsigned long long digits = chunk ^ 0x3030303030303030ULL;
+    unsigned long long nonDigits = ((digits + 0x7676767676767676ULL) | digits) & 0x8080808080808080ULL;
+    int count = nonDigits == 0 ? 8 : __builtin_ctzll(nonDigits) / 8;
+    if (count == 0)
+        return 0;
+
+    // Moves the digits to the high bytes, so the lower bytes act as leading zeroes.
+    digits <<= 8 * (8 - count);
+    digits = digits * 10 + (digits >> 8);
+    digits = (((digits & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+              + (((digits >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    value = digits;
+    return count;
+}
+#endif
+
+bool InStream::scanMappedInt(int &value) {
+    __TESTLIB_PROFILE_SCOPE(__TESTLIB_PROFILE_SCAN_INT);
+    static const unsigned long long powersOf10[9] = {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL
+    };
+
+    const char *p = mappedReader->cursor();
+    const char *end = mappedReader->limit();
+    int lineFeeds = 0;
+
+    if (!strict)
+        while (p < end && isBlanks(*p)) {
+            if (*p == LF)
+                lineFeeds++;
+            p++;
+        }
+
+    bool negative = p < end && *p == '-';
+    const char *digitsBegin = negative ? p + 1 : p;
+    const char *q = digitsBegin;
+    unsigned long long result = 0;
+
+    for (;;) {
+#ifdef __TESTLIB_SWAR_DIGITS
+        if (end - q >= 8) {
+            unsigned long long chunk = 0;
+            int count = __testlib_scanDigits8(q, chunk);
+            result = result * powersOf10[count] + chunk;
+            q += count;
+            if (count < 8 || q - digitsBegin > 10)
+                break;
+            continue;
+        }
+#endif
+        while (q < end && *q >= '0' && *q <= '9' && q - digitsBegin <= 10)
+            result = result * 10 + (*q++ - '0');
+        break;
+    }
+
+    size_t length = size_t(q - digitsBegin);
+    if (length == 0 || length > 10 || (q < end && !isBlanks(*q)))
+        return false;
+    if (*digitsBegin == '0' && (length > 1 || negative))
+        return false;
+    if (result > (negative ? 2147483648ULL : 2147483647ULL))
+        return false;
+
+    lastLine = mappedReader->lineNumber() + lineFeeds;
+    mappedReader->advanceTo(q, lineFeeds);
+    value = negative ? int(-(long long) result) : int(result);
+    __TESTLIB_PROFILE_COUNT(&profile, tokens, 1);
+    return true;
+}
+
+NORETURN void InStream::quitIntRange(int value, int minv, int maxv, const std::string &variableName) {
+    if (variableName.empty())
+        quit(_wa, ("Integer element [index=" + vtos(readManyIteration) + "] equals to " + vtos(value) +
+                   ", violates the range [" + toHumanReadableString(minv) + ", " + toHumanReadableString(maxv) + "]").c_str());
+    else
+        quit(_wa,
+             ("Integer element " + std::string(variableName) + "[" + vtos(readManyIteration) + "] equals to " +
+              vtos(value) + ", violates the range [" + toHumanReadableString(minv) + ", " + toHumanReadableString(maxv) + "]").c_str());
+}
+
+void InStream::readIntsTo(int *result, int size, int minv, int maxv, const std::string &variablesName, int indexBase) {
+    if (size < 0)
+        quit(_fail, "readIntsTo: size should be non-negative.");
+    if (size > 100000000)
+        quit(_fail, "readIntsTo: size should be at most 100000000.");
+
     if (strict && !variablesName.empty())
         validator.addVariable(variablesName);
-    __testlib_readMany(readIntegers, readInt(minv, maxv, variablesName), int, true)
+
+    int minRead = INT_MAX;
+    int maxRead = INT_MIN;
+    readManyIteration = indexBase;
+
+    for (int i = 0; i < size; i++) {
+        int value;
+        // Malformed tokens go through readInt() to fail with the usual message.
+        if (NULL == mappedReader || !scanMappedInt(value))
+            value = readInt();
+
+        if (value < minv || value > maxv)
+            quitIntRange(value, minv, maxv, variablesName);
+
+        result[i] = value;
+        minRead = __testlib_min(minRead, value);
+        maxRead = __testlib_max(maxRead, value);
+        readManyIteration++;
+
+        if (strict && i + 1 < size) {
+            const char *p = NULL == mappedReader ? NULL : mappedReader->cursor();
+            if (NULL != p && p < mappedReader->limit() && *p == SPACE)
+                mappedReader->advanceTo(p + 1, 0);
+            else
+                readSpace();
+        }
+    }
+
+    readManyIteration = NO_INDEX;
+
+    if (strict && !variablesName.empty() && size > 0) {
+        validator.addBoundsHit(variablesName, ValidatorBoundsHit(minRead == minv, maxRead == maxv));
+        validator.adjustConstantBounds(variablesName, minv, maxv);
+    }
 }
 
-std::vector<int> InStream::readIntegers(int size, int indexBase) {
-    __testlib_readMany(readIntegers, readInt(), int, true)
+void InStream::readIntsTo(int *result, int size, int indexBase) {
+    readIntsTo(result, size, INT_MIN, INT_MAX, "", indexBase);
+}
+
+void InStream::readIntsTo(std::vector<int> &result, int size, int minv, int maxv, const std::string &variablesName,
+                          int indexBase) {
+    if (size < 0)
+        quit(_fail, "readIntsTo: size should be non-negative.");
+    if (size > 100000000)
+        quit(_fail, "readIntsTo: size should be at most 100000000.");
+
+    result.resize(size);
+    readIntsTo(result.data(), size, minv, maxv, variablesName, indexBase);
+}
+
+void InStream::readIntsTo(std::vector<int> &result, int size, int indexBase) {
+    readIntsTo(result, size, INT_MIN, INT_MAX, "", indexBase);
 }
 
 double InStream::readReal() {
@@ -4434,6 +5267,7 @@ void InStream::close() {
         reader->close();
         delete reader;
         reader = NULL;
+        mappedReader = NULL;
     }
 
     opened = false;
@@ -4557,7 +5391,9 @@ NORETURN void __testlib_help() {
     std::fprintf(stderr, "\n");
 
     std::fprintf(stderr, "Program must be run with the following arguments: \n");
-    std::fprintf(stderr, "    [--testset testset] [--group group] <input-file> <output-file> <answer-file> [<report-file> [<-appes>]]\n\n");
+    std::fprintf(stderr, "    [--testset testset] [--group group] [--verdict-json verdict-file] <input-file> <output-file> <answer-file> [<report-file> [<-appes>]]\n");
+    std::fprintf(stderr, "Or, for checkers, in server mode with <input-file>\\t<output-file>\\t<answer-file> lines on stdin:\n");
+    std::fprintf(stderr, "    [--testset testset] [--group group] --server\n\n");
 
     __testlib_exitCode = FAIL_EXIT_CODE;
     std::exit(FAIL_EXIT_CODE);
@@ -4611,9 +5447,258 @@ static void __testlib_set_testset_and_group(int argc, char* argv[]) {
     }
 }
 
-void registerGen(int argc, char *argv[], int randomGeneratorVersion) {
-    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 1)
-        quitf(_fail, "Random generator version is expected to be 0 or 1.");
+static const char __testlib_digitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+/*
+ * Large output buffer for generators. Integers are formatted without iostreams,
+ * data is written to the file only when the buffer is full, on flush() and at exit.
+ *
+ * Use the global instance "gout": gout.write(n); gout.writeInts(a); gout.writeEdges(edges);
+ * After registerGen(argc, argv, 1, true) std::cout also writes into gout, so "cout << endl"
+ * doesn't flush anymore. Don't mix it with printf/puts: they bypass the buffer.
+ */
+class BufferedOutputWriter : public std::streambuf {
+private:
+    static const size_t BUFFER_SIZE;
+
+    std::FILE *file;
+    char *buffer;
+    std::ostream *redirectedStream;
+    std::streambuf *redirectedBuffer;
+
+    void writeBuffer() {
+        size_t size = size_t(pptr() - pbase());
+        if (size > 0 && std::fwrite(pbase(), 1, size, file) != size)
+            __testlib_fail("BufferedOutputWriter: unable to write output");
+        setp(buffer, buffer + BUFFER_SIZE);
+    }
+
+    /* Ensures that at least size bytes can be put without flushing. */
+    inline void reserve(size_t size) {
+        if (size_t(epptr() - pptr()) < size) {
+            if (NULL == buffer) {
+                buffer = new char[BUFFER_SIZE];
+                setp(buffer, buffer + BUFFER_SIZE);
+            } else
+                writeBuffer();
+        }
+    }
+
+    void writeUnsigned(unsigned long long value, bool negative) {
+        char digits[24];
+        char *end = digits + sizeof(digits);
+        char *p = end;
+        while (value >= 100) {
+            unsigned index = unsigned(value % 100) * 2;
+            value /= 100;
+            *--p = __testlib_digitPairs[index + 1];
+            *--p = __testlib_digitPairs[index];
+        }
+        if (value >= 10) {
+            *--p = __testlib_digitPairs[value * 2 + 1];
+            *--p = __testlib_digitPairs[value * 2];
+        } else
+            *--p = char('0' + value);
+        if (negative)
+            *--p = '-';
+
+        reserve(sizeof(digits));
+        std::memcpy(pptr(), p, size_t(end - p));
+        pbump(int(end - p));
+    }
+
+    void writeSigned(long long value) {
+        if (value < 0)
+            writeUnsigned(0ULL - (unsigned long long) value, true);
+        else
+            writeUnsigned((unsigned long long) value, false);
+    }
+
+protected:
+    int overflow(int c) {
+        reserve(1);
+        if (c != EOF) {
+            *pptr() = char(c);
+            pbump(1);
+        }
+        return c == EOF ? 0 : c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) {
+        write(s, size_t(n));
+        return n;
+    }
+
+    /* Called by std::endl and std::flush: intentionally doesn't write anything. */
+    int sync() {
+        return 0;
+    }
+
+public:
+    explicit BufferedOutputWriter(std::FILE *file = stdout)
+            : file(file), buffer(NULL), redirectedStream(NULL), redirectedBuffer(NULL) {
+        setp(NULL, NULL);
+    }
+
+    ~BufferedOutputWriter() {
+        if (NULL != redirectedStream)
+            redirectedStream->rdbuf(redirectedBuffer);
+        if (NULL != buffer) {
+            size_t size = size_t(pptr() - pbase());
+            if (size > 0)
+                std::fwrite(pbase(), 1, size, file);
+            std::fflush(file);
+            delete[] buffer;
+            buffer = NULL;
+        }
+    }
+
+    /* Makes the stream (usually std::cout) write into this buffer until the program exits. */
+    void redirect(std::ostream &stream) {
+        if (NULL != redirectedStream)
+            __testlib_fail("BufferedOutputWriter::redirect: the buffer is already attached to a stream");
+        redirectedStream = &stream;
+        redirectedBuffer = stream.rdbuf(this);
+    }
+
+    void flush() {
+        if (NULL != buffer)
+            writeBuffer();
+        if (std::fflush(file) != 0)
+            __testlib_fail("BufferedOutputWriter: unable to flush output");
+    }
+
+    void write(char c) {
+        reserve(1);
+        *pptr() = c;
+        pbump(1);
+    }
+
+    void write(const char *s, size_t length) {
+        if (length > BUFFER_SIZE / 2) {
+            if (NULL != buffer)
+                writeBuffer();
+            if (std::fwrite(s, 1, length, file) != length)
+                __testlib_fail("BufferedOutputWriter: unable to write output");
+            return;
+        }
+        reserve(length);
+        std::memcpy(pptr(), s, length);
+        pbump(int(length));
+    }
+
+    void write(const char *s) {
+        write(s, std::strlen(s));
+    }
+
+    void write(const std::string &s) {
+        write(s.data(), s.length());
+    }
+
+    void write(int value) {
+        writeSigned(value);
+    }
+
+    void write(long value) {
+        writeSigned(value);
+    }
+
+    void write(long long value) {
+        writeSigned(value);
+    }
+
+    void write(unsigned int value) {
+        writeUnsigned(value, false);
+    }
+
+    void write(unsigned long value) {
+        writeUnsigned(value, false);
+    }
+
+    void write(unsigned long long value) {
+        writeUnsigned(value, false);
+    }
+
+    /* Writes the values separated by separator, followed by the end of line. */
+    template<typename Iterator>
+    void writeInts(Iterator first, Iterator last, char separator = ' ') {
+        for (Iterator i = first; i != last; i++) {
+            if (i != first)
+                write(separator);
+            write(*i);
+        }
+        write(LF);
+    }
+
+    template<typename Container>
+    void writeInts(const Container &values, char separator = ' ') {
+        writeInts(values.begin(), values.end(), separator);
+    }
+
+    /* Writes each pair as a separate line "first second". */
+    template<typename Iterator>
+    void writeEdges(Iterator first, Iterator last) {
+        for (Iterator i = first; i != last; i++) {
+            write(i->first);
+            write(SPACE);
+            write(i->second);
+            write(LF);
+        }
+    }
+
+    template<typename Container>
+    void writeEdges(const Container &edges) {
+        writeEdges(edges.begin(), edges.end());
+    }
+
+    /* Writes a flat edge buffer "u1 v1 u2 v2 ..." as lines "u v", the number of values must be even. */
+    template<typename Iterator>
+    void writeFlatEdges(Iterator first, Iterator last) {
+        for (Iterator i = first; i != last; i++) {
+            write(*i);
+            write(SPACE);
+            if (++i == last)
+                __testlib_fail("BufferedOutputWriter::writeFlatEdges: odd number of values");
+            write(*i);
+            write(LF);
+        }
+    }
+
+    template<typename Container>
+    void writeFlatEdges(const Container &edges) {
+        writeFlatEdges(edges.begin(), edges.end());
+    }
+};
+
+const size_t BufferedOutputWriter::BUFFER_SIZE = 1 << 20;
+
+BufferedOutputWriter gout;
+
+#ifndef ON_WINDOWS
+static int __testlib_generatorMultigen(int argc, char *argv[]);
+#endif
+
+/*
+ * Use bufferedOutput = true to make std::cout write into the large "gout" buffer
+ * (std::endl doesn't flush), the output is written on exit.
+ *
+ * randomGeneratorVersion 2 makes rnd use the xoshiro256** engine instead of the 48-bit LCG of versions 0 and 1:
+ * faster, with 64 bits per step. The same arguments give different tests than with version 1, keep version 1
+ * in generators of existing tasks so their tests regenerate identically.
+ */
+void registerGen(int argc, char *argv[], int randomGeneratorVersion, bool bufferedOutput = false) {
+    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 2)
+        quitf(_fail, "Random generator version is expected to be 0, 1 or 2.");
     random_t::version = randomGeneratorVersion;
 
     __testlib_ensuresPreconditions();
@@ -4621,8 +5706,18 @@ void registerGen(int argc, char *argv[], int randomGeneratorVersion) {
 
     testlibMode = _generator;
     __testlib_set_binary(stdin);
+    if (argc >= 2 && !strcmp("--multigen", argv[1])) {
+#ifdef ON_WINDOWS
+        quit(_fail, "Generator multigen mode is not supported on Windows");
+#else
+        argc = __testlib_generatorMultigen(argc, argv);
+#endif
+    }
     rnd.setSeed(argc, argv);
 
+    if (bufferedOutput)
+        gout.redirect(std::cout);
+
 #if __cplusplus > 199711L || defined(_MSC_VER)
     prepareOpts(argc, argv);
 #endif
@@ -4750,6 +5845,10 @@ void registerValidation() {
     inf.strict = true;
 }
 
+#ifndef ON_WINDOWS
+static std::string __testlib_validatorBatch();
+#endif
+
 void registerValidation(int argc, char *argv[]) {
     registerValidation();
     __testlib_set_testset_and_group(argc, argv);
@@ -4764,7 +5863,9 @@ void registerValidation(int argc, char *argv[]) {
                             " [--testMarkupFileName fileName]"
                             " [--testCase testCase]"
                             " [--testCaseFileName fileName]"
+                            " [--batch]"
                             ;
+    bool batch = false;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp("--testset", argv[i])) {
@@ -4807,7 +5908,27 @@ void registerValidation(int argc, char *argv[]) {
             } else
                 quit(_fail, comment);
         }
+        if (!strcmp("--batch", argv[i]))
+            batch = true;
+    }
+
+    if (batch) {
+#ifdef ON_WINDOWS
+        quit(_fail, "Validator batch mode is not supported on Windows");
+#else
+        if (!validator.testMarkupFileName().empty() || validator.testCase() > 0)
+            quit(_fail, "Validator batch mode doesn't support test markup and test case extraction");
+        inf.init(__testlib_validatorBatch(), _input);
+        if (!inf.opened)
+            quit(_fail, "Input file not found: \"" + inf.name + "\"");
+        inf.strict = true;
+        return;
+#endif
     }
+
+    // Test markup and test case extraction need the characters recorded by FileInputStreamReader.
+    if (validator.testMarkupFileName().empty() && validator.testCase() <= 0)
+        inf.mapStdfile(stdin);
 }
 
 void addFeature(const std::string &feature) {
@@ -4825,13 +5946,21 @@ void feature(const std::string &feature) {
 class Checker {
 private:
     bool _initialized;
+    bool _inputRead;
     std::string _testset;
     std::string _group;
 
 public:
-    Checker() : _initialized(false), _testset("tests"), _group() {
+    Checker() : _initialized(false), _inputRead(false), _testset("tests"), _group() {
     }
 
+    /*
+     * Call it after the whole input is read from inf, before reading ouf and ans.
+     * In checker server mode (--server) all later outputs of the same input are checked from here,
+     * otherwise it does nothing.
+     */
+    void inputRead();
+
     void initialize() {
         _initialized = true;
     }
@@ -4857,6 +5986,491 @@ public:
     }
 } checker;
 
+#ifndef ON_WINDOWS
+/*
+ * Checker server mode: "checker --server" reads requests "<input-file>\t<output-file>\t<answer-file>\n"
+ * from stdin and answers each with one JSON verdict line on stdout (see __testlib_jsonVerdict).
+ *
+ * Every input file gets a forked process which returns from registerTestlibCmd into main() to check
+ * the first request. If main() calls checker.inputRead() after reading inf, that process stays alive
+ * and forks a copy of itself for every further (output, answer) pair of the same input, so the input
+ * is parsed once. The last TESTLIB_SERVER_CACHED_INPUTS inputs are kept. Checkers without the call
+ * work too, with one fork per request.
+ */
+#ifndef TESTLIB_SERVER_CACHED_INPUTS
+#   define TESTLIB_SERVER_CACHED_INPUTS 8
+#endif
+
+std::vector<std::string> split(const std::string &s, char separator);
+
+static int __testlib_serverRequestFd = -1;
+
+struct __testlib_serverInput {
+    std::string fileName;
+    struct stat fileStat;
+    pid_t pid;
+    int requestFd;
+    int responseFd;
+    bool persistent;
+    unsigned long long lastUse;
+};
+
+static bool __testlib_readLine(int fd, std::string &line) {
+    line.clear();
+    for (;;) {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return !line.empty();
+        if (c == '\n')
+            return true;
+        line += c;
+    }
+}
+
+static std::string __testlib_readAll(int fd) {
+    std::string data;
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return data;
+        data.append(buffer, size_t(n));
+    }
+}
+
+static std::string __testlib_serverCrashVerdict(int status, const std::string &program = "Checker") {
+    if (WIFSIGNALED(status))
+        return __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE,
+                                     program + " was killed by signal " + vtos(WTERMSIG(status)));
+    return __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE,
+                                 program + " exited with code " + vtos(WEXITSTATUS(status)) + " without a verdict");
+}
+
+static void __testlib_serverStop(__testlib_serverInput &input, int *status = NULL) {
+    close(input.requestFd);
+    close(input.responseFd);
+    if (NULL == status)
+        kill(input.pid, SIGKILL);
+    int stopStatus;
+    while (waitpid(input.pid, &stopStatus, 0) < 0 && errno == EINTR);
+    if (NULL != status)
+        *status = stopStatus;
+}
+
+/*
+ * Runs the server loop. Returns only in a forked process, with files set to the request it has to check.
+ */
+static void __testlib_checkerServer(std::vector<std::string> &files) {
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<__testlib_serverInput> inputs;
+    unsigned long long useCounter = 0;
+    std::string request;
+
+    while (__testlib_readLine(0, request)) {
+        std::vector<std::string> requestFiles = split(request, '\t');
+        struct stat fileStat;
+        if (requestFiles.size() != 3) {
+            __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE,
+                    "Expected request <input-file>\\t<output-file>\\t<answer-file>"));
+            continue;
+        }
+        if (stat(requestFiles[0].c_str(), &fileStat) != 0) {
+            __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE,
+                    "Input file not found: \"" + requestFiles[0] + "\""));
+            continue;
+        }
+
+        int index = -1;
+        for (int i = 0; i < int(inputs.size()); i++)
+            if (inputs[i].fileName == requestFiles[0]) {
+                const struct stat &cached = inputs[i].fileStat;
+                if (cached.st_dev == fileStat.st_dev && cached.st_ino == fileStat.st_ino
+                        && cached.st_size == fileStat.st_size && cached.st_mtime == fileStat.st_mtime) {
+                    index = i;
+                } else {
+                    // The input file was replaced, its parse is stale.
+                    __testlib_serverStop(inputs[i]);
+                    inputs.erase(inputs.begin() + i);
+                }
+                break;
+            }
+
+        if (index == -1) {
+            if (inputs.size() >= TESTLIB_SERVER_CACHED_INPUTS) {
+                int oldest = 0;
+                for (int i = 1; i < int(inputs.size()); i++)
+                    if (inputs[i].lastUse < inputs[oldest].lastUse)
+                        oldest = i;
+                __testlib_serverStop(inputs[oldest]);
+                inputs.erase(inputs.begin() + oldest);
+            }
+
+            int requestPipe[2], responsePipe[2];
+            if (pipe(requestPipe) != 0) {
+                __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't create pipe"));
+                continue;
+            }
+            if (pipe(responsePipe) != 0) {
+                close(requestPipe[0]);
+                close(requestPipe[1]);
+                __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't create pipe"));
+                continue;
+            }
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                for (size_t i = 0; i < inputs.size(); i++) {
+                    close(inputs[i].requestFd);
+                    close(inputs[i].responseFd);
+                }
+                close(requestPipe[1]);
+                close(responsePipe[0]);
+                __testlib_serverRequestFd = requestPipe[0];
+                __testlib_verdictFd = responsePipe[1];
+                // The check is timed from its request, not from the start of the server.
+                __testlib_startCheckTimer();
+
+                // Requests and verdicts go through the pipes only.
+                int devNull = open("/dev/null", O_RDWR);
+                dup2(devNull, 0);
+                dup2(devNull, 1);
+                close(devNull);
+
+                files = requestFiles;
+                return;
+            }
+
+            close(requestPipe[0]);
+            close(responsePipe[1]);
+            if (pid < 0) {
+                close(requestPipe[1]);
+                close(responsePipe[0]);
+                __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't fork checker"));
+                continue;
+            }
+
+            __testlib_serverInput input;
+            input.fileName = requestFiles[0];
+            input.fileStat = fileStat;
+            input.pid = pid;
+            input.requestFd = requestPipe[1];
+            input.responseFd = responsePipe[0];
+            input.persistent = false;
+            inputs.push_back(input);
+            index = int(inputs.size()) - 1;
+        } else
+            __testlib_writeAll(inputs[index].requestFd, requestFiles[1] + "\t" + requestFiles[2] + "\n");
+
+        __testlib_serverInput &input = inputs[index];
+        input.lastUse = ++useCounter;
+
+        // The process sends '+' once it has called checker.inputRead() and waits for more requests.
+        std::string verdict;
+        bool answered = __testlib_readLine(input.responseFd, verdict);
+        if (answered && !verdict.empty() && verdict[0] == '+') {
+            input.persistent = true;
+            verdict.erase(0, 1);
+            answered = !verdict.empty() || __testlib_readLine(input.responseFd, verdict);
+        }
+
+        if (answered && input.persistent) {
+            __testlib_writeAll(1, verdict + "\n");
+        } else {
+            int status;
+            __testlib_serverStop(input, &status);
+            __testlib_writeAll(1, answered ? verdict + "\n" : __testlib_serverCrashVerdict(status));
+            inputs.erase(inputs.begin() + index);
+        }
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++)
+        __testlib_serverStop(inputs[i]);
+    _exit(0);
+}
+#endif
+
+void Checker::inputRead() {
+#ifndef ON_WINDOWS
+    if (__testlib_serverRequestFd < 0 || _inputRead)
+        return;
+    _inputRead = true;
+
+    int responseFd = __testlib_verdictFd;
+    __testlib_writeAll(responseFd, "+");
+
+    // ouf and ans are already opened for the first request.
+    bool first = true;
+    std::string request;
+    std::vector<std::string> files;
+    for (;;) {
+        int resultPipe[2];
+        if (pipe(resultPipe) != 0) {
+            __testlib_writeAll(responseFd, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't create pipe"));
+            _exit(FAIL_EXIT_CODE);
+        }
+
+        std::fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(resultPipe[0]);
+            close(__testlib_serverRequestFd);
+            close(responseFd);
+            __testlib_serverRequestFd = -1;
+            __testlib_verdictFd = resultPipe[1];
+            __testlib_startCheckTimer();
+            if (!first) {
+                ouf.init(files[0], _output);
+                ouf.skipBom();
+                ans.init(files[1], _answer);
+            }
+            return;
+        }
+
+        close(resultPipe[1]);
+        std::string verdict;
+        int status = 0;
+        if (pid > 0) {
+            verdict = __testlib_readAll(resultPipe[0]);
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        } else
+            verdict = __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't fork checker");
+        close(resultPipe[0]);
+        __testlib_writeAll(responseFd, verdict.empty() ? __testlib_serverCrashVerdict(status) : verdict);
+
+        if (!__testlib_readLine(__testlib_serverRequestFd, request))
+            _exit(0);
+        files = split(request, '\t');
+        first = false;
+    }
+#endif
+}
+
+#ifndef ON_WINDOWS
+/*
+ * Validator batch mode: "validator --batch" reads requests "<input-file>\t<group>\n" from stdin and answers
+ * each with one JSON verdict line on stdout: OK, or FAIL with the message (see __testlib_jsonVerdict).
+ *
+ * Every request is validated by a process forked from the registered validator, which returns from
+ * registerValidation into main() with inf opened on the file and validator.group() set. The children
+ * start from the parent's initialized state (streams, buffers, static arrays) instead of a new process.
+ *
+ * At EOF the bounds hits and features of the valid files are written per group, like the test overview log,
+ * to --testOverviewLogFileName (stderr by default):
+ *
+ *     group "3": 4 valid, 1 invalid
+ *     "N": min-value-hit 0/4 max-value-hit 3/4
+ *     feature "line": hit 2/4
+ *
+ * Counts are the valid files of the group that hit the bound or feature.
+ */
+struct __testlib_batchCoverage {
+    int valid;
+    int invalid;
+    std::map<std::string, std::pair<int, int> > boundsHits;
+    std::map<std::string, int> featureHits;
+
+    __testlib_batchCoverage() : valid(0), invalid(0) {
+    }
+
+    /* Adds the test overview log of one valid file (see Validator::getTestOverviewLog). */
+    void add(const std::string &overviewLog) {
+        valid++;
+        std::istringstream lines(overviewLog);
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t nameEnd = line.find("\":");
+            if (nameEnd == std::string::npos)
+                continue;
+            std::string flags = line.substr(nameEnd + 2);
+            if (line[0] == '"') {
+                std::pair<int, int> &hits = boundsHits[line.substr(1, nameEnd - 1)];
+                hits.first += flags.find("min-value-hit") != std::string::npos;
+                hits.second += flags.find("max-value-hit") != std::string::npos;
+            } else if (line.compare(0, 9, "feature \"") == 0) {
+                featureHits[line.substr(9, nameEnd - 9)] += flags.find("hit") != std::string::npos;
+            }
+        }
+    }
+
+    std::string log(const std::string &group) const {
+        std::string result = "group \"" + group + "\": " + vtos(valid) + " valid, " + vtos(invalid) + " invalid\n";
+        std::string total = "/" + vtos(valid);
+        for (std::map<std::string, std::pair<int, int> >::const_iterator i = boundsHits.begin();
+             i != boundsHits.end(); i++)
+            result += "\"" + i->first + "\": min-value-hit " + vtos(i->second.first) + total
+                      + " max-value-hit " + vtos(i->second.second) + total + "\n";
+        for (std::map<std::string, int>::const_iterator i = featureHits.begin(); i != featureHits.end(); i++)
+            result += "feature \"" + i->first + "\": hit " + vtos(i->second) + total + "\n";
+        return result;
+    }
+};
+
+/*
+ * Runs the batch loop. Returns only in a forked process, with the name of the file it has to validate.
+ */
+static std::string __testlib_validatorBatch() {
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string summaryName = validator.testOverviewLogFileName();
+    std::map<std::string, __testlib_batchCoverage> coverage;
+    std::vector<std::string> groups;  // in the order of their first request
+    std::string request;
+
+    while (__testlib_readLine(0, request)) {
+        std::vector<std::string> fields = split(request, '\t');
+        if (fields.size() != 2) {
+            __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE,
+                    "Expected request <input-file>\\t<group>"));
+            continue;
+        }
+
+        int resultPipe[2];
+        if (pipe(resultPipe) != 0) {
+            __testlib_writeAll(1, __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't create pipe"));
+            continue;
+        }
+
+        std::fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(resultPipe[0]);
+            __testlib_verdictFd = resultPipe[1];
+
+            // The verdict goes through the pipe only, the message is part of it.
+            int devNull = open("/dev/null", O_RDWR);
+            dup2(devNull, 0);
+            dup2(devNull, 1);
+            dup2(devNull, 2);
+            close(devNull);
+
+            validator.setGroup(fields[1].c_str());
+            validator.setTestOverviewLogFileName("");
+            __testlib_startCheckTimer();
+            return fields[0];
+        }
+
+        close(resultPipe[1]);
+        std::string result;
+        int status = 0;
+        if (pid > 0) {
+            result = __testlib_readAll(resultPipe[0]);
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+        } else
+            result = __testlib_jsonVerdict("FAIL", FAIL_EXIT_CODE, "Can't fork validator");
+        close(resultPipe[0]);
+
+        size_t verdictEnd = result.find('\n');
+        std::string verdict = verdictEnd == std::string::npos
+                ? __testlib_serverCrashVerdict(status, "Validator") : result.substr(0, verdictEnd + 1);
+
+        if (coverage.find(fields[1]) == coverage.end())
+            groups.push_back(fields[1]);
+        __testlib_batchCoverage &groupCoverage = coverage[fields[1]];
+        if (verdict.compare(0, 17, "{\"verdict\": \"OK\",") == 0)
+            groupCoverage.add(result.substr(verdictEnd + 1));
+        else
+            groupCoverage.invalid++;
+        __testlib_writeAll(1, verdict);
+    }
+
+    std::string summary;
+    for (size_t i = 0; i < groups.size(); i++)
+        summary += coverage[groups[i]].log(groups[i]);
+    if (summaryName.empty() || summaryName == "stderr")
+        __testlib_writeAll(2, summary);
+    else if (summaryName == "stdout")
+        __testlib_writeAll(1, summary);
+    else {
+        int fd = open(summaryName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::fprintf(stderr, "Can't write the coverage summary to (%s)\n", summaryName.c_str());
+            _exit(FAIL_EXIT_CODE);
+        }
+        __testlib_writeAll(fd, summary);
+        close(fd);
+    }
+    _exit(0);
+}
+
+/*
+ * Generator multigen mode: "gen --multigen <manifest> [<padding>...]" generates one test per manifest line
+ * "<output-file>\t<arg1>\t<arg2>...", the tab-separated arguments of a separate run of the generator.
+ *
+ * Every line is generated by a process forked from the registered generator: argv is rewritten to
+ * "gen <arg1> <arg2>..." and stdout to the output file, then registerGen seeds rnd and parses the opts
+ * from the new arguments and returns into main(). A test is the same as from "gen <arg1> <arg2>... > <output-file>".
+ * The arguments are written into the original argv array, so it must have at least as many entries as the
+ * longest line has arguments (pad the command line), and main() must read them from argv or opt() after
+ * registerGen, not from its argc.
+ *
+ * The parent prints "<output-file>\t<status>" per line, where the status is the exit code of the generator
+ * or "signal <number>", and exits with code 0 if every test was generated.
+ */
+static int __testlib_generatorMultigen(int argc, char *argv[]) {
+    if (argc < 3)
+        quit(_fail, "Expected gen --multigen <manifest> [<padding>...]");
+    int manifestFd = open(argv[2], O_RDONLY);
+    if (manifestFd < 0)
+        quit(_fail, std::string("Can't open the multigen manifest ") + argv[2]);
+
+    static std::vector<std::string> args;  // argv of the forked generator points into it
+    bool failed = false;
+    std::string line;
+
+    while (__testlib_readLine(manifestFd, line)) {
+        if (line.empty())
+            continue;
+        std::vector<std::string> fields = split(line, '\t');
+        if (int(fields.size()) > argc) {
+            std::fprintf(stderr, "Multigen test %s has %d arguments, only %d fit into argv\n",
+                         fields[0].c_str(), int(fields.size()) - 1, argc - 1);
+            __testlib_writeAll(1, fields[0] + "\t" + vtos(FAIL_EXIT_CODE) + "\n");
+            failed = true;
+            continue;
+        }
+
+        std::fflush(stdout);
+        std::fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(manifestFd);
+            int outputFd = open(fields[0].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0)
+                quit(_fail, "Can't create multigen test " + fields[0]);
+            dup2(outputFd, 1);
+            close(outputFd);
+
+            args.assign(fields.begin() + 1, fields.end());
+            for (size_t i = 0; i < args.size(); i++)
+                argv[i + 1] = const_cast<char *>(args[i].c_str());
+            argv[args.size() + 1] = NULL;
+            return int(args.size()) + 1;
+        }
+
+        int status = 0;
+        std::string result;
+        if (pid > 0) {
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+            result = WIFSIGNALED(status) ? "signal " + vtos(WTERMSIG(status)) : vtos(WEXITSTATUS(status));
+        } else {
+            std::fprintf(stderr, "Can't fork generator for multigen test %s\n", fields[0].c_str());
+            result = vtos(FAIL_EXIT_CODE);
+        }
+        failed = failed || result != "0";
+        __testlib_writeAll(1, fields[0] + "\t" + result + "\n");
+    }
+
+    close(manifestFd);
+    _exit(failed ? 1 : 0);
+}
+#endif
+
 void registerTestlibCmd(int argc, char *argv[]) {
     __testlib_ensuresPreconditions();
     __testlib_set_testset_and_group(argc, argv);
@@ -4867,9 +6481,18 @@ void registerTestlibCmd(int argc, char *argv[]) {
 
     std::vector<std::string> args(1, argv[0]);
     checker.initialize();
+    bool server = false;
+    std::string verdictJsonName;
 
     for (int i = 1; i < argc; i++) {
-        if (!strcmp("--testset", argv[i])) {
+        if (!strcmp("--server", argv[i])) {
+            server = true;
+        } else if (!strcmp("--verdict-json", argv[i])) {
+            if (i + 1 < argc && strlen(argv[i + 1]) > 0)
+                verdictJsonName = argv[++i];
+            else
+                quit(_fail, std::string("Expected file name after --verdict-json command line parameter"));
+        } else if (!strcmp("--testset", argv[i])) {
             if (i + 1 < argc && strlen(argv[i + 1]) > 0)
                 checker.setTestset(argv[++i]);
             else
@@ -4883,6 +6506,24 @@ void registerTestlibCmd(int argc, char *argv[]) {
             args.push_back(argv[i]);
     }
 
+#ifdef ON_WINDOWS
+    if (server || !verdictJsonName.empty())
+        quit(_fail, std::string("Checker server mode and JSON verdicts are not supported on Windows"));
+#else
+    __testlib_startCheckTimer();
+    if (server) {
+        if (args.size() != 1 || !verdictJsonName.empty())
+            quit(_fail, std::string("Checker server mode takes the files from stdin, not from the command line"));
+        std::vector<std::string> files;
+        __testlib_checkerServer(files);
+        args.insert(args.end(), files.begin(), files.end());
+    } else if (!verdictJsonName.empty()) {
+        __testlib_verdictFd = open(verdictJsonName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (__testlib_verdictFd < 0)
+            quit(_fail, "Can not write to the verdict file \"" + verdictJsonName + "\"");
+    }
+#endif
+
     argc = int(args.size());
     if (argc > 1 && "--help" == args[1])
         __testlib_help();
@@ -6296,4 +7937,233 @@ std::string format(const std::string fmt, ...) {
 }
 #endif
 
-#endif
\ No newline at end of file
+#if __cplusplus >= 201703L
+/*
+ * Input schemas: the layout of an input as a type, so a checker and a validator can share one definition.
+ *
+ *     constexpr char N[] = "N", K[] = "K", f[] = "f", e[] = "e", u[] = "u", v[] = "v";
+ *     using Input = schema::Schema<
+ *             schema::Line<schema::Int<N, schema::Val<2>, schema::Val<MAXN>>, schema::Int<K, schema::Val<1>, schema::Var<N>>>,
+ *             schema::Line<schema::Ints<f, schema::Var<N>, schema::Val<1>, schema::Var<K>>>,
+ *             schema::Edges<e, u, v, schema::Var<N, -1>, schema::Val<1>, schema::Var<N>>>;
+ *
+ *     Input input;
+ *     input.read(inf);
+ *     int n = int(input.get<N>());
+ *     const std::vector<int> &freq = input.array<f>();
+ *
+ * Fields are named by constexpr char arrays (C++17 can't take string literals as template arguments).
+ * Bounds and counts are Val<constant> or Var<earlier scalar field, added constant>, so the parser is specialized
+ * for the layout at compile time: no field names are looked up while reading and every array is allocated once.
+ *
+ * A strict stream (validator) reads the exact layout: single spaces inside a Line, EOLN after it, EOF at the end,
+ * with the bounds hits of every named field. A non-strict stream (checker) reads the same tokens, ignoring whitespace.
+ *
+ *     Int<Name, Min, Max>                 one integer, read with get<Name>()
+ *     Ints<Name, Count, Min, Max>         Count integers separated by spaces, read with array<Name>()
+ *     Edges<Name, U, V, Count, Min, Max>  Count lines "u v", stored flat as u1 v1 u2 v2 ... in array<Name>(),
+ *                                         each endpoint checked and named as the field U or V
+ *     Line<Fields...>                     Int and Ints fields on one line
+ */
+namespace schema {
+
+template<const char *...Names>
+struct NameList {
+    static constexpr int size = int(sizeof...(Names));
+
+    static constexpr int indexOf(const char *name) {
+        const char *names[] = {Names..., nullptr};
+        for (int i = 0; i < size; i++)
+            if (names[i] == name)
+                return i;
+        return -1;
+    }
+};
+
+template<typename... Lists>
+struct Concat {
+    typedef NameList<> type;
+};
+
+template<const char *...Names>
+struct Concat<NameList<Names...> > {
+    typedef NameList<Names...> type;
+};
+
+template<const char *...A, const char *...B, typename... Rest>
+struct Concat<NameList<A...>, NameList<B...>, Rest...> {
+    typedef typename Concat<NameList<A..., B...>, Rest...>::type type;
+};
+
+/* A constant bound or count. */
+template<long long Value>
+struct Val {
+    template<typename Values>
+    static long long get(const Values &) {
+        return Value;
+    }
+};
+
+/* The value of an earlier Int field plus Add. */
+template<const char *Name, long long Add = 0>
+struct Var {
+    template<typename Values>
+    static long long get(const Values &values) {
+        return values.template get<Name>() + Add;
+    }
+};
+
+template<const char *Name, typename Min, typename Max>
+struct Int {
+    typedef NameList<Name> Scalars;
+    typedef NameList<> Arrays;
+
+    template<typename Values>
+    static void read(InStream &in, Values &values) {
+        values.template set<Name>(in.readInt(int(Min::get(values)), int(Max::get(values)), Name));
+    }
+};
+
+template<const char *Name, typename Count, typename Min, typename Max>
+struct Ints {
+    typedef NameList<> Scalars;
+    typedef NameList<Name> Arrays;
+
+    template<typename Values>
+    static void read(InStream &in, Values &values) {
+        in.readIntsTo(values.template array<Name>(), int(Count::get(values)),
+                      int(Min::get(values)), int(Max::get(values)), Name);
+    }
+};
+
+template<const char *Name, const char *U, const char *V, typename Count, typename Min, typename Max>
+struct Edges {
+    typedef NameList<> Scalars;
+    typedef NameList<Name> Arrays;
+
+    template<typename Values>
+    static void read(InStream &in, Values &values) {
+        int count = int(Count::get(values));
+        int minv = int(Min::get(values));
+        int maxv = int(Max::get(values));
+        std::vector<int> &edges = values.template array<Name>();
+        if (!in.strict) {
+            in.readIntsTo(edges, 2 * count);
+            for (int i = 0; i < 2 * count; i++)
+                checkEndpoint(in, edges[i], minv, maxv, i % 2 == 0 ? U : V);
+            return;
+        }
+
+        if (count < 0)
+            quit(_fail, "schema::Edges: count should be non-negative.");
+        edges.resize(2 * size_t(count));
+        // Unnamed reads skip the validator bookkeeping, the bounds hits of u and v are added once for all edges
+        int minRead[2] = {INT_MAX, INT_MAX};
+        int maxRead[2] = {INT_MIN, INT_MIN};
+        for (int i = 0; i < 2 * count; i++) {
+            int &value = edges[i];
+            in.readIntsTo(&value, 1, i + 1);
+            checkEndpoint(in, value, minv, maxv, i % 2 == 0 ? U : V);
+            minRead[i % 2] = __testlib_min(minRead[i % 2], value);
+            maxRead[i % 2] = __testlib_max(maxRead[i % 2], value);
+            if (i % 2 == 0)
+                in.readSpace();
+            else
+                in.readEoln();
+        }
+        if (count > 0) {
+            const char *names[2] = {U, V};
+            for (int j = 0; j < 2; j++) {
+                validator.addVariable(names[j]);
+                validator.addBoundsHit(names[j], ValidatorBoundsHit(minRead[j] == minv, maxRead[j] == maxv));
+                validator.adjustConstantBounds(names[j], minv, maxv);
+            }
+        }
+    }
+
+private:
+    /* Fails with the message of readInt(minv, maxv, name). */
+    static void checkEndpoint(InStream &in, int value, int minv, int maxv, const char *name) {
+        if (value < minv || value > maxv)
+            in.quit(_wa, ("Integer parameter [name=" + std::string(name) + "] equals to " + vtos(value) +
+                          ", violates the range [" + toHumanReadableString(minv) + ", " + toHumanReadableString(maxv) +
+                          "]").c_str());
+    }
+};
+
+template<typename... Fields>
+struct Line {
+    typedef typename Concat<typename Fields::Scalars...>::type Scalars;
+    typedef typename Concat<typename Fields::Arrays...>::type Arrays;
+
+    template<typename Values>
+    static void read(InStream &in, Values &values) {
+        bool first = true;
+        ((first ? void(first = false) : separate(in), Fields::read(in, values)), ...);
+        if (in.strict)
+            in.readEoln();
+    }
+
+private:
+    static void separate(InStream &in) {
+        if (in.strict)
+            in.readSpace();
+    }
+};
+
+template<typename... Parts>
+class Schema {
+public:
+    typedef typename Concat<typename Parts::Scalars...>::type Scalars;
+    typedef typename Concat<typename Parts::Arrays...>::type Arrays;
+
+    /* Reads the parts in order, a strict stream must end after them. */
+    void read(InStream &in) {
+        (Parts::read(in, *this), ...);
+        if (in.strict)
+            in.readEof();
+    }
+
+    template<const char *Name>
+    long long get() const {
+        return scalars[scalarIndex<Name>()];
+    }
+
+    template<const char *Name>
+    void set(long long value) {
+        scalars[scalarIndex<Name>()] = value;
+    }
+
+    template<const char *Name>
+    std::vector<int> &array() {
+        return arrays[arrayIndex<Name>()];
+    }
+
+    template<const char *Name>
+    const std::vector<int> &array() const {
+        return arrays[arrayIndex<Name>()];
+    }
+
+private:
+    long long scalars[Scalars::size > 0 ? Scalars::size : 1] = {};
+    std::vector<int> arrays[Arrays::size > 0 ? Arrays::size : 1];
+
+    template<const char *Name>
+    static constexpr int scalarIndex() {
+        constexpr int index = Scalars::indexOf(Name);
+        static_assert(index >= 0, "schema: no Int field with this name");
+        return index;
+    }
+
+    template<const char *Name>
+    static constexpr int arrayIndex() {
+        constexpr int index = Arrays::indexOf(Name);
+        static_assert(index >= 0, "schema: no Ints or Edges field with this name");
+        return index;
+    }
+};
+
+} // namespace schema
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Tree generators for testlib generators. Include it after "testlib.h", all randomness comes from "rnd".
+ *
+ * Every generator runs in O(n) and returns the tree on vertices 1..n as one flat parent array:
+ * parent[v] is the neighbour of v towards the root and parent[root] = 0 (index 0 is unused).
+ * Except for pruferTree() the root is 1 and parent[v] < v. Shuffle the labels before printing,
+ * e.g. the structured shapes put the long path on vertices 1, 2, 3, ...
+ *
+ *     std::vector<int> parent = caterpillarTree(n, n / 2);
+ *     for (int v = 1; v <= n; v++)
+ *         if (parent[v] != 0)
+ *             gout.write(parent[v]), gout.write(' '), gout.write(v), gout.write('\n');
+ */
+
+#ifndef _TREEGEN_H_
+#define _TREEGEN_H_
+
+#include <vector>
+
+/*
+ * Decodes a Prüfer sequence of length n - 2 (values in 1..n) in O(n), the tree is rooted at n.
+ * Uses the classic linear decoding: the smallest leaf is tracked by a pointer that only moves forward,
+ * a vertex that becomes a leaf below the pointer is removed immediately.
+ */
+std::vector<int> pruferTree(int n, const std::vector<int> &sequence) {
+    if (n < 1 || int(sequence.size()) != (n >= 2 ? n - 2 : 0))
+        __testlib_fail("pruferTree(n, sequence): sequence must have n - 2 elements");
+
+    std::vector<int> parent(n + 1, 1);          // holds vertex degrees until the vertex is removed
+    for (int x : sequence) {
+        if (x < 1 || x > n)
+            __testlib_fail("pruferTree(n, sequence): sequence values must be in [1, n]");
+        parent[x]++;
+    }
+
+    int ptr = 1;
+    while (ptr < n && parent[ptr] != 1)
+        ptr++;
+    int leaf = ptr;
+    for (int x : sequence) {
+        parent[leaf] = -x;                      // negative marks a removed vertex (its parent)
+        if (--parent[x] == 1 && x < ptr) {
+            leaf = x;
+        } else {
+            ptr++;
+            while (parent[ptr] != 1)
+                ptr++;
+            leaf = ptr;
+        }
+    }
+    if (n >= 2)
+        parent[leaf] = -n;
+
+    parent[0] = 0;
+    for (int v = 1; v <= n; v++)
+        parent[v] = v == n ? 0 : -parent[v];
+    return parent;
+}
+
+/* Uniformly random labeled tree: decodes a random Prüfer sequence. */
+std::vector<int> randomTree(int n) {
+    std::vector<int> sequence(n >= 2 ? n - 2 : 0);
+    for (int &x : sequence)
+        x = rnd.next(1, n);
+    return pruferTree(n, sequence);
+}
+
+/* Path 1 - 2 - ... - n. */
+std::vector<int> pathTree(int n) {
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= n; v++)
+        parent[v] = v - 1;
+    return parent;
+}
+
+/* Every vertex has at most k children, filled level by level (k = 1 is a path, k = n - 1 a star). */
+std::vector<int> karyTree(int n, int k) {
+    if (k < 1)
+        __testlib_fail("karyTree(n, k): k must be positive");
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= n; v++)
+        parent[v] = (v - 2) / k + 1;
+    return parent;
+}
+
+/* Spine path 1..spine, the other vertices are leaves attached to random spine vertices. */
+std::vector<int> caterpillarTree(int n, int spine) {
+    if (spine < 1 || spine > n)
+        __testlib_fail("caterpillarTree(n, spine): spine must be in [1, n]");
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= spine; v++)
+        parent[v] = v - 1;
+    for (int v = spine + 1; v <= n; v++)
+        parent[v] = rnd.next(1, spine);
+    return parent;
+}
+
+/* Handle path 1..handle, the other vertices are leaves of the last handle vertex (the brush). */
+std::vector<int> broomTree(int n, int handle) {
+    if (handle < 1 || handle > n)
+        __testlib_fail("broomTree(n, handle): handle must be in [1, n]");
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= handle; v++)
+        parent[v] = v - 1;
+    for (int v = handle + 1; v <= n; v++)
+        parent[v] = handle;
+    return parent;
+}
+
+/*
+ * Long path 1..pathLength with random bushes of up to bushSize vertices hanging from random path vertices.
+ * Inside a bush each vertex picks a random parent among the earlier vertices of the same bush.
+ */
+std::vector<int> pathWithBushesTree(int n, int pathLength, int bushSize) {
+    if (pathLength < 1 || pathLength > n || bushSize < 1)
+        __testlib_fail("pathWithBushesTree(n, pathLength, bushSize): pathLength must be in [1, n], bushSize positive");
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= pathLength; v++)
+        parent[v] = v - 1;
+    for (int bush = pathLength + 1; bush <= n; bush += bushSize) {
+        parent[bush] = rnd.next(1, pathLength);
+        for (int v = bush + 1; v < bush + bushSize && v <= n; v++)
+            parent[v] = rnd.next(bush, v - 1);
+    }
+    return parent;
+}
+
+/*
+ * Depth-controlled tree: vertex v picks parent rnd.wnext(v - 1, t) + 1.
+ * t = 0 is the plain random recursive tree (depth O(log n)), large positive t approaches a path
+ * (parents close to v - 1), large negative t a star (parents close to 1). It is O(n) for a fixed t.
+ */
+std::vector<int> wnextTree(int n, int t) {
+    std::vector<int> parent(n + 1, 0);
+    for (int v = 2; v <= n; v++)
+        parent[v] = rnd.wnext(v - 1, t) + 1;
+    return parent;
+}
+
+#endif
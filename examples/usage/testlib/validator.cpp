@@ -1,57 +1,58 @@
+#include "testlib.h"
+#include "input_schema.h"
 #include <bits/stdc++.h>
-#include "testlib.h"
 using namespace std;
 
-const int MAXN = 500'000;
-const int MAXL = 1'000'000'000;
+int deg[MAXN+5];
+// Disjoint set union over the edges: parent of v, or -(component size) for a root
+int dsu[MAXN+5];
 
-vector<int> adj[MAXN+5];
-bool visited[MAXN+5] = {0};
-vector<int> dfs_stack;
+int findRoot(int v) {
+    while (dsu[v] >= 0) {
+        if (dsu[dsu[v]] >= 0) dsu[v] = dsu[dsu[v]];
+        v = dsu[v];
+    }
+    return v;
+}
+
+// Returns false if u and v are already connected (the edge closes a cycle)
+bool unite(int u, int v) {
+    u = findRoot(u); v = findRoot(v);
+    if (u == v) return false;
+    if (dsu[u] > dsu[v]) swap(u, v);
+    dsu[u] += dsu[v];
+    dsu[v] = u;
+    return true;
+}
 
 int main(int argc, char* argv[]) {
     registerValidation(argc, argv);
 
-    int N = inf.readInt(2,MAXN,"N"); inf.readSpace();
-    int K = inf.readInt(1,MAXL,"K"); inf.readSpace();
-    int L = inf.readInt(K+1,MAXL,"L");
-    inf.readEoln();
+    radiotorni::Input input;
+    input.read(inf);
+    int N = int(input.get<radiotorni::N>());
+    int K = int(input.get<radiotorni::K>());
+    int L = int(input.get<radiotorni::L>());
+    const vector<int> &f = input.array<radiotorni::f>();
+    const vector<int> &edges = input.array<radiotorni::edge>();
 
-    int f1 = 0;
-    for (int i=1; i<=N; i++) {
-        int fi = inf.readInt(K,L,"fi"); if (i<N) {inf.readSpace();}
-        if (validator.group() == "4") {
-            if (i == 1) {f1 = fi;}
-            else {inf.ensuref(f1 == fi, "Different frequencies");}
-        }
+    if (validator.group() == "4") {
+        for (int i=1; i<N; i++) {inf.ensuref(f[0] == f[i], "Different frequencies");}
     }
-    inf.readEoln();
 
-    for (int i=1; i<=N-1; i++) {
-        int u = inf.readInt(1,N,"u"); inf.readSpace();
-        int v = inf.readInt(1,N,"v");
-        inf.readEoln();
+    // N-1 edges without a cycle connect all N vertices
+    fill(dsu+1, dsu+N+1, -1);
+    bool isTree = true;
+    for (int i=0; i<N-1; i++) {
+        int u = edges[2*i], v = edges[2*i+1];
 
         inf.ensure(u != v);
 
-        adj[u].push_back(v);
-        adj[v].push_back(u);
+        deg[u]++; deg[v]++;
+        if (!unite(u, v)) isTree = false;
     }
-    inf.readEof();
 
-    dfs_stack.push_back(1);
-    while (dfs_stack.size() > 0) {
-        int v = dfs_stack.back();
-        dfs_stack.pop_back();
-        visited[v] = true;
-        for (int u : adj[v]) {
-            if (!visited[u]) {dfs_stack.push_back(u);}
-        }
-    }
-
-    for (int i = 1; i <= N; i++) {
-        inf.ensuref(visited[i], "Not a tree");
-    }
+    inf.ensuref(isTree, "Not a tree");
 
 	if (validator.group() == "0") {
         //inf.ensure();
@@ -60,7 +61,7 @@ int main(int argc, char* argv[]) {
     } else if (validator.group() == "2") {
         inf.ensure(L == K+1);
     } else if (validator.group() == "3") {
-        for (int i=1; i<=N; i++) {inf.ensure(adj[i].size() <= 2);}
+        for (int i=1; i<=N; i++) {inf.ensure(deg[i] <= 2);}
     } else if (validator.group() == "4") {
         // Already checked
     } else if (validator.group() == "5") {
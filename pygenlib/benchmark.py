@@ -0,0 +1,228 @@
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import asdict, dataclass
+from typing import Iterable, Optional
+import csv
+import json
+import logging
+import math
+import os
+import statistics
+
+from pygenlib.isolate import SandboxPool, pinned_cpus
+from pygenlib.report import (CheckerServer, ReporterConfig, TestCaseResult, _compile_checker, _detect_language,
+                             _list_test_files, _read_solution, _resolve_memory_limit, _resolve_reporter_config,
+                             _resolve_time_limit, _run_test, _test_group)
+
+logger = logging.getLogger(__name__)
+
+
+@dataclass
+class BenchmarkStats:
+    """Timings of one solution on one test over all repeats"""
+
+    solution: str  # Solution file name without extension
+    test_name: str  # Test case name without task prefix
+    verdict: str  # Verdict of the runs, e.g. "AC/TLE" when repeats disagree
+    runs: int
+    cpu_min: float  # CPU time in seconds
+    cpu_median: float
+    cpu_p95: float
+    wall_min: float  # Wall clock time in seconds
+    wall_median: float
+    wall_p95: float
+    max_rss_mib: float  # Peak RSS over all runs in MiB
+
+
+@dataclass
+class GroupSlowdown:
+    """Slowest median CPU time of each solution in a testgroup, relative to the model solution"""
+
+    group: str  # Testgroup number, e.g. "01"
+    model_cpu: float  # Slowest median CPU time of the model solution on the group's tests
+    time_limit_ratio: Optional[float]  # time_limit / model_cpu, the safety margin of the model solution
+    slowdown: dict[str, Optional[float]]  # Solution -> its slowest median CPU time / model_cpu
+
+
+def benchmark(sol_paths: Iterable[str], repeats: int = 5, model_solution: Optional[str] = None,
+              cfg: Optional[ReporterConfig] = None, workers: Optional[int] = None,
+              box_ids: Optional[Iterable[int]] = None, pool: Optional[SandboxPool] = None) -> dict:
+    """Run every (solution, test) pair repeats times and write timing statistics next to the reports.
+
+    Writes {reports_dir}/{task_name}_benchmark.tsv (min/median/p95 CPU and wall time, peak RSS
+    per solution and test), {task_name}_slowdown.tsv (per testgroup, the slowest median CPU time
+    of each solution divided by the model solution's) and {task_name}_benchmark.json with both.
+    The time limit (cfg.time_limit or time_limit of cfg.task_yaml_path) decides TLE verdicts,
+    the memory limit (cfg.memory_limit or memory_limit of cfg.task_yaml_path) MLE verdicts.
+
+    Args:
+        sol_paths: Solutions to benchmark, the model solution included.
+        repeats: Runs per (solution, test) pair.
+        model_solution: Solution the slowdown is relative to, defaults to the first of sol_paths.
+        cfg: Reporter configuration, resolved like in report() when omitted.
+        workers, box_ids, pool: Isolate boxes to run in, like in report_all(). Boxes are pinned to
+            distinct CPU cores; use workers=1 on machines with few cores for the least noise.
+
+    Returns the JSON document that is written to {task_name}_benchmark.json.
+    """
+    cfg = _resolve_reporter_config(cfg)
+    sol_paths = list(sol_paths)
+    if repeats < 1:
+        raise ValueError(f"repeats must be positive, got {repeats}")
+    model_solution = model_solution or sol_paths[0]
+    if model_solution not in sol_paths:
+        sol_paths.insert(0, model_solution)
+
+    checker_executable = _compile_checker(cfg) if cfg.checker_path else None
+    time_limit = _resolve_time_limit(cfg)
+    memory_limit = _resolve_memory_limit(cfg)
+    solutions = [(_solution_name(sol_path), _read_solution(sol_path), _detect_language(sol_path))
+                 for sol_path in sol_paths]
+    test_files = _list_test_files(cfg)
+
+    own_pool = pool is None
+    if own_pool:
+        if box_ids is None:
+            box_ids = range(workers or len(os.sched_getaffinity(0)))
+        box_ids = list(box_ids)
+        pool = SandboxPool(box_ids, cpus=pinned_cpus(len(box_ids)))
+    logger.info(
+        f"Benchmarking {len(solutions)} solutions on {len(test_files)} tests, {repeats} repeats, "
+        f"time limit {time_limit:g}s, using {len(pool)} isolate boxes"
+    )
+
+    checker = CheckerServer(checker_executable, compare_first=cfg.compare_outputs) if checker_executable else None
+
+    def run_pair(sol_code: str, lang: str, test_file: str) -> TestCaseResult:
+        with pool.sandbox() as sandbox:
+            return _run_test(os.path.join(cfg.tests_dir, test_file), sol_code, lang, checker, sandbox, time_limit,
+                             memory_limit=memory_limit)
+
+    stats: list[BenchmarkStats] = []
+    try:
+        with ThreadPoolExecutor(max_workers=len(pool)) as executor:
+            # Repeat-major order, so a burst of load on the machine doesn't hit all runs of one pair
+            futures = {}
+            for repeat in range(repeats):
+                for test_file in test_files:
+                    for name, sol_code, lang in solutions:
+                        futures.setdefault((name, test_file), []).append(
+                            executor.submit(run_pair, sol_code, lang, test_file))
+            try:
+                for name, _, _ in solutions:
+                    for test_file in test_files:
+                        results = [future.result() for future in futures[(name, test_file)]]
+                        stats.append(_summarize(name, results))
+            except BaseException:
+                for pair_futures in futures.values():
+                    for future in pair_futures:
+                        future.cancel()
+                raise
+    finally:
+        if own_pool:
+            pool.close()
+        if checker is not None:
+            checker.close()
+
+    model_name = _solution_name(model_solution)
+    groups = _group_slowdowns(stats, model_name, [name for name, _, _ in solutions], time_limit)
+
+    os.makedirs(cfg.reports_dir, exist_ok=True)
+    prefix = os.path.join(cfg.reports_dir, f"{cfg.task_name}_")
+    _write_stats_tsv(f"{prefix}benchmark.tsv", stats)
+    _write_slowdown_tsv(f"{prefix}slowdown.tsv", groups, [name for name, _, _ in solutions if name != model_name])
+    document = {
+        "time_limit": time_limit,
+        "repeats": repeats,
+        "model_solution": model_name,
+        "tests": [asdict(s) for s in stats],
+        "groups": [asdict(g) for g in groups],
+    }
+    with open(f"{prefix}benchmark.json", "w") as f:
+        json.dump(document, f, indent=2)
+    logger.info(f"Benchmark written to {prefix}benchmark.tsv, {prefix}slowdown.tsv and {prefix}benchmark.json")
+    return document
+
+
+def _solution_name(sol_path: str) -> str:
+    return os.path.splitext(os.path.basename(sol_path))[0]
+
+
+def _percentile(values: list[float], q: float) -> float:
+    """Nearest-rank percentile, q in (0, 1]"""
+    ordered = sorted(values)
+    return ordered[max(0, math.ceil(q * len(ordered)) - 1)]
+
+
+def _summarize(solution: str, results: list[TestCaseResult]) -> BenchmarkStats:
+    cpu = [r.exec_time for r in results]
+    wall = [r.wall_time for r in results]
+    verdicts = sorted({r.verdict for r in results})
+    if len(verdicts) > 1:
+        logger.warning(f"{solution} on test {results[0].test_name} has different verdicts: {'/'.join(verdicts)}")
+    return BenchmarkStats(
+        solution=solution,
+        test_name=results[0].test_name,
+        verdict="/".join(verdicts),
+        runs=len(results),
+        cpu_min=min(cpu),
+        cpu_median=statistics.median(cpu),
+        cpu_p95=_percentile(cpu, 0.95),
+        wall_min=min(wall),
+        wall_median=statistics.median(wall),
+        wall_p95=_percentile(wall, 0.95),
+        max_rss_mib=max(r.max_rss_mib for r in results),
+    )
+
+
+def _group_slowdowns(stats: list[BenchmarkStats], model_name: str, solution_names: list[str],
+                     time_limit: float) -> list[GroupSlowdown]:
+    slowest: dict[str, dict[str, float]] = {}
+    for s in stats:
+        group = slowest.setdefault(_test_group(s.test_name), {})
+        group[s.solution] = max(group.get(s.solution, 0.0), s.cpu_median)
+
+    groups = []
+    for group in sorted(slowest):
+        model_cpu = slowest[group].get(model_name, 0.0)
+        slowdown = {
+            name: slowest[group][name] / model_cpu if model_cpu > 0 else None
+            for name in solution_names if name != model_name and name in slowest[group]
+        }
+        groups.append(GroupSlowdown(
+            group=group,
+            model_cpu=model_cpu,
+            time_limit_ratio=time_limit / model_cpu if model_cpu > 0 else None,
+            slowdown=slowdown,
+        ))
+    return groups
+
+
+def _format_ratio(ratio: Optional[float]) -> str:
+    return f"{ratio:.2f}" if ratio is not None else "-"
+
+
+def _write_stats_tsv(output_path: str, stats: list[BenchmarkStats]):
+    with open(output_path, "w", newline="") as f:
+        writer = csv.writer(f, delimiter="\t")
+        writer.writerow(["solution", "test", "res", "runs",
+                         "[cpu min]", "[cpu med]", "[cpu p95]", "[wall min]", "[wall med]", "[wall p95]", "[rss mib]"])
+        for s in stats:
+            writer.writerow([
+                s.solution, s.test_name + " ", s.verdict, s.runs,
+                f"{s.cpu_min:.3f}", f"{s.cpu_median:.3f}", f"{s.cpu_p95:.3f}",
+                f"{s.wall_min:.3f}", f"{s.wall_median:.3f}", f"{s.wall_p95:.3f}",
+                f"{s.max_rss_mib:.2f}",
+            ])
+    logger.debug(f"Benchmark statistics written to {output_path}")
+
+
+def _write_slowdown_tsv(output_path: str, groups: list[GroupSlowdown], solution_names: list[str]):
+    with open(output_path, "w", newline="") as f:
+        writer = csv.writer(f, delimiter="\t")
+        writer.writerow(["group", "[model sec]", "tl/model", *solution_names])
+        for g in groups:
+            writer.writerow([
+                g.group + " ", f"{g.model_cpu:.3f}", _format_ratio(g.time_limit_ratio),
+                *(_format_ratio(g.slowdown.get(name)) for name in solution_names),
+            ])
+    logger.debug(f"Slowdown ratios written to {output_path}")
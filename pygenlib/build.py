@@ -0,0 +1,158 @@
+import functools
+import hashlib
+import logging
+import os
+import platform
+import shutil
+import subprocess
+import tempfile
+import threading
+from typing import Mapping, Optional, Sequence
+
+from pygenlib import config, trace
+
+logger = logging.getLogger(__name__)
+
+CXX = "g++"
+CXX_FLAGS = ("-O2", "-std=c++17")
+
+# Headers that are compiled once into a precompiled header (.gch) and shared by all builds
+PCH_HEADERS = ("testlib.h",)
+
+
+def prepare_extra_files(extra_files: Optional[Mapping[str, str]]) -> dict[str, str]:
+    """Return mapping of filename->contents for extra files given as file paths or literal contents."""
+    prepared: dict[str, str] = {}
+    if not extra_files:
+        return prepared
+    for filename, src in extra_files.items():
+        if os.path.isfile(src):
+            with open(src, "r") as f:
+                prepared[filename] = f.read()
+        else:
+            prepared[filename] = src
+    return prepared
+
+
+def compile_cpp(source_code: str, extra_files: Optional[Mapping[str, str]] = None, cache_dir: Optional[str] = None,
+                cxx: str = CXX, flags: Sequence[str] = CXX_FLAGS) -> str:
+    """Compile C++ source through the build cache and return the path of the executable.
+
+    The cache key covers the compiler (path, version, target), flags, host architecture,
+    the source and the extra files, so changing any of them gives a new build.
+    Entries are written to a temporary file and renamed into place, so concurrent
+    builds of the same key (threads or processes) never see a partial executable.
+
+    Args:
+        source_code: C++ source code
+        extra_files: Dictionary mapping filenames to file contents placed next to the source (headers)
+        cache_dir: Defaults to the configured cache dir, builds go to {cache_dir}/build
+        cxx: Compiler executable
+        flags: Compiler flags
+    """
+    extra_files = dict(extra_files or {})
+    build_dir = os.path.join(cache_dir or config.get_cache_dir_path(), "build")
+    os.makedirs(build_dir, exist_ok=True)
+
+    m = hashlib.sha256()
+    for part in [_toolchain_id(cxx), *flags, platform.machine(), source_code]:
+        m.update(part.encode())
+        m.update(b"\0")
+    for filename in sorted(extra_files):
+        m.update(filename.encode())
+        m.update(b"\0")
+        m.update(extra_files[filename].encode())
+        m.update(b"\0")
+    key = m.hexdigest()
+    exe_path = os.path.join(build_dir, key)
+
+    with _build_lock(key):
+        if os.path.exists(exe_path):
+            logger.debug(f"Using cached executable: {exe_path}")
+            trace.cache("build", hit=True)
+            return exe_path
+        trace.cache("build", hit=False)
+
+        include_dirs = []
+        for header in PCH_HEADERS:
+            if header in extra_files:
+                pch_dir = _precompiled_header(header, extra_files[header], build_dir, cxx, flags)
+                if pch_dir is not None:
+                    include_dirs.append(pch_dir)
+                    del extra_files[header]
+
+        with tempfile.TemporaryDirectory(dir=build_dir, prefix="src-") as tmpdir:
+            src_path = os.path.join(tmpdir, "solution.cpp")
+            logger.debug(f"Writing source to {src_path}")
+            with open(src_path, "w") as f:
+                f.write(source_code)
+            for filename, content in extra_files.items():
+                file_path = os.path.join(tmpdir, filename)
+                logger.debug(f"Writing additional file: {file_path}")
+                os.makedirs(os.path.dirname(file_path), exist_ok=True)
+                with open(file_path, "w") as f:
+                    f.write(content)
+
+            tmp_exe = os.path.join(tmpdir, "solution")
+            compile_cmd = [cxx, *flags, *(f"-I{d}" for d in include_dirs), src_path, "-o", tmp_exe]
+            logger.debug(f"Compiling C++ code: {' '.join(compile_cmd)}")
+            with trace.span("build.compile", "build", source_bytes=len(source_code)):
+                compile_proc = subprocess.run(compile_cmd, cwd=tmpdir, capture_output=True, text=True)
+            if compile_proc.returncode != 0:
+                logger.error(f"Compilation failed: {compile_proc.stderr}")
+                raise RuntimeError(f"Compilation failed: {compile_proc.stderr}")
+
+            logger.debug(f"Caching executable to {exe_path}")
+            os.replace(tmp_exe, exe_path)
+    return exe_path
+
+
+def _precompiled_header(header: str, content: str, build_dir: str, cxx: str, flags: Sequence[str]) -> Optional[str]:
+    """Return a directory holding header and its .gch, built once per (toolchain, flags, content)"""
+    m = hashlib.sha256()
+    for part in [_toolchain_id(cxx), *flags, platform.machine(), header, content]:
+        m.update(part.encode())
+        m.update(b"\0")
+    pch_dir = os.path.join(build_dir, "pch", m.hexdigest())
+
+    with _build_lock(pch_dir):
+        if os.path.exists(pch_dir):
+            return pch_dir
+
+        os.makedirs(os.path.dirname(pch_dir), exist_ok=True)
+        tmpdir = tempfile.mkdtemp(dir=os.path.dirname(pch_dir), prefix=".tmp-")
+        try:
+            with open(os.path.join(tmpdir, header), "w") as f:
+                f.write(content)
+            pch_cmd = [cxx, *flags, "-x", "c++-header", header, "-o", f"{header}.gch"]
+            logger.debug(f"Precompiling header: {' '.join(pch_cmd)}")
+            pch_proc = subprocess.run(pch_cmd, cwd=tmpdir, capture_output=True, text=True)
+            if pch_proc.returncode != 0:
+                # Not fatal, the header is then compiled as part of every source
+                logger.warning(f"Failed to precompile {header}: {pch_proc.stderr}")
+                return None
+            try:
+                os.rename(tmpdir, pch_dir)
+            except OSError:
+                # Another process renamed its build into place first
+                pass
+            return pch_dir
+        finally:
+            shutil.rmtree(tmpdir, ignore_errors=True)
+
+
+@functools.lru_cache(maxsize=None)
+def _toolchain_id(cxx: str) -> str:
+    """Identify the compiler by its resolved path, version and target"""
+    cxx_path = shutil.which(cxx) or cxx
+    proc = subprocess.run([cxx_path, "-dumpfullversion", "-dumpmachine"], capture_output=True, text=True)
+    return f"{os.path.realpath(cxx_path)} {' '.join(proc.stdout.split())}"
+
+
+# Serializes builds of the same key inside this process, so parallel runs compile it only once
+_build_locks: dict[str, threading.Lock] = {}
+_build_locks_guard = threading.Lock()
+
+def _build_lock(key: str) -> threading.Lock:
+    with _build_locks_guard:
+        return _build_locks.setdefault(key, threading.Lock())
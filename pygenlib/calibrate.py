@@ -0,0 +1,225 @@
+from dataclasses import asdict, dataclass
+from typing import Optional
+import hashlib
+import json
+import logging
+import math
+import os
+import platform
+import sys
+import tempfile
+
+from pygenlib import config
+from pygenlib.build import compile_cpp
+from pygenlib.isolate import Sandbox, run_cpp_code
+
+logger = logging.getLogger(__name__)
+
+# Kernels resembling what solutions spend their time on, each reports the best CPU time of REPEATS runs:
+# streaming over a 64 MiB array, unpredictable branches on integers and a DFS over a shuffled random tree.
+_BENCHMARK_CPP = r"""
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+static const int REPEATS = 3;
+
+static double cpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+}
+
+template<typename Kernel>
+static double best(Kernel kernel, uint64_t &checksum) {
+    double result = 1e9;
+    for (int r = 0; r < REPEATS; r++) {
+        double start = cpuSeconds();
+        checksum += kernel();
+        result = std::min(result, cpuSeconds() - start);
+    }
+    return result;
+}
+
+static uint64_t xorshift(uint64_t &x) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+int main() {
+    uint64_t checksum = 0;
+
+    std::vector<uint64_t> data(8 << 20);  // 64 MiB
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 2654435761u;
+    double bandwidth = best([&]() {
+        uint64_t sum = 0;
+        for (int pass = 0; pass < 4; pass++)
+            for (size_t i = 0; i < data.size(); i++) {
+                sum += data[i];
+                data[i] += pass;
+            }
+        return sum;
+    }, checksum);
+
+    double branchy = best([&]() {
+        uint64_t x = 88172645463325252ull, a = 0, b = 0;
+        for (int i = 0; i < 30000000; i++) {
+            uint64_t v = xorshift(x);
+            if (v & 1)
+                a += v % 7;
+            else if (v & 2)
+                b ^= v >> 3;
+            else
+                a -= b & 0xff;
+        }
+        return a + b;
+    }, checksum);
+
+    const int n = 1 << 20;
+    std::vector<int> order(n), parent(n, -1), start(n + 1, 0), children(n), stack;
+    uint64_t x = 2463534242ull;
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+    for (int i = n - 1; i > 0; i--)
+        std::swap(order[i], order[xorshift(x) % (i + 1)]);
+    for (int i = 1; i < n; i++)
+        parent[order[i]] = order[xorshift(x) % i];
+    for (int v = 0; v < n; v++)
+        if (parent[v] >= 0)
+            start[parent[v] + 1]++;
+    for (int v = 0; v < n; v++)
+        start[v + 1] += start[v];
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int v = 0; v < n; v++)
+        if (parent[v] >= 0)
+            children[fill[parent[v]]++] = v;
+    double pointerChase = best([&]() {
+        uint64_t visited = 0;
+        for (int pass = 0; pass < 4; pass++) {
+            stack.assign(1, order[0]);
+            while (!stack.empty()) {
+                int v = stack.back();
+                stack.pop_back();
+                visited += v;
+                for (int i = start[v]; i < start[v + 1]; i++)
+                    stack.push_back(children[i]);
+            }
+        }
+        return visited;
+    }, checksum);
+
+    std::printf("{\"bandwidth\": %.6f, \"branchy\": %.6f, \"pointer_chase\": %.6f, \"checksum\": %llu}\n",
+                bandwidth, branchy, pointerChase, (unsigned long long) checksum);
+}
+"""
+
+
+@dataclass
+class Calibration:
+    """Best CPU seconds of each benchmark kernel on a host"""
+    host: str
+    bandwidth: float
+    branchy: float
+    pointer_chase: float
+
+    @property
+    def score(self) -> float:
+        """Geometric mean of the kernel times, smaller on a faster host"""
+        return math.exp((math.log(self.bandwidth) + math.log(self.branchy) + math.log(self.pointer_chase)) / 3)
+
+
+@dataclass
+class TimeNormalization:
+    """Converts CPU times measured on this host to calibration units and to the judge machine"""
+    host: Calibration
+    judge: Optional[Calibration] = None
+
+    def normalized(self, seconds: float) -> float:
+        """seconds in units of this host's calibration score, comparable between hosts"""
+        return seconds / self.host.score
+
+    def judge_time(self, seconds: float) -> Optional[float]:
+        """Estimated CPU time on the judge, None without a judge calibration"""
+        if self.judge is None:
+            return None
+        return seconds * self.judge.score / self.host.score
+
+
+def calibrate(cache_dir: Optional[str] = None, sandbox: Optional[Sandbox] = None, force: bool = False) -> Calibration:
+    """Calibration of this host, measured once and cached in {cache_dir}/calibration.
+
+    The entry is keyed by host name, CPU model and the benchmark build (which covers compiler and flags).
+    The benchmark runs in isolate like the solutions, in sandbox or in box 0.
+
+    Args:
+        cache_dir: Defaults to the configured cache dir.
+        sandbox: Pooled box to run the benchmark in.
+        force: Measure again even if the host is cached.
+    """
+    cache_dir = cache_dir or config.get_cache_dir_path()
+    calibration_dir = os.path.join(cache_dir, "calibration")
+    os.makedirs(calibration_dir, exist_ok=True)
+    executable = compile_cpp(_BENCHMARK_CPP, cache_dir=cache_dir)
+    host = f"{platform.node()} {_cpu_model()}"
+    key = hashlib.sha256(f"{host}\0{os.path.basename(executable)}".encode()).hexdigest()
+    cached_path = os.path.join(calibration_dir, f"{key}.json")
+
+    if not force:
+        try:
+            return load_calibration(cached_path)
+        except (OSError, ValueError, TypeError):
+            pass
+
+    logger.info(f"Calibrating host {host}")
+    run_res = run_cpp_code(_BENCHMARK_CPP, "", time_limit=60.0, sandbox=sandbox)
+    if run_res.exit_code != 0:
+        raise RuntimeError(f"Calibration benchmark failed with exit code {run_res.exit_code}: {run_res.stderr}")
+    times = json.loads(run_res.stdout)
+    calibration = Calibration(host=host, bandwidth=times["bandwidth"], branchy=times["branchy"],
+                              pointer_chase=times["pointer_chase"])
+    logger.info(f"Host calibration: bandwidth {calibration.bandwidth:.3f}s, branchy {calibration.branchy:.3f}s, "
+                f"pointer chase {calibration.pointer_chase:.3f}s, score {calibration.score:.3f}")
+    save_calibration(calibration, cached_path)
+    return calibration
+
+
+def load_calibration(path: str) -> Calibration:
+    with open(path) as f:
+        return Calibration(**json.load(f))
+
+
+def save_calibration(calibration: Calibration, path: str):
+    # Write, then rename, so concurrent reports never read a partial entry
+    fd, tmp_path = tempfile.mkstemp(dir=os.path.dirname(os.path.abspath(path)), prefix=".tmp-")
+    try:
+        with os.fdopen(fd, "w") as f:
+            json.dump(asdict(calibration), f)
+        os.replace(tmp_path, path)
+    except BaseException:
+        os.remove(tmp_path)
+        raise
+
+
+def _cpu_model() -> str:
+    try:
+        with open("/proc/cpuinfo") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    return line.split(":", 1)[1].strip()
+    except OSError:
+        pass
+    return platform.processor() or platform.machine()
+
+
+if __name__ == "__main__":
+    # python3 -m pygenlib.calibrate judge.json, on the judge machine, for ReporterConfig(judge_calibration=...)
+    logging.basicConfig(level=logging.INFO)
+    result = calibrate(force=True)
+    if len(sys.argv) > 1:
+        save_calibration(result, sys.argv[1])
+    print(json.dumps(asdict(result)))
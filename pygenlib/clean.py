@@ -5,12 +5,12 @@ import shutil
 from pygenlib import config
 
 
-def clean():
+def clean(keep_test_cache: bool = True):
     """Cleans up generated files and directories.
     
     Removes:
     - all .out files
-    - cache directory
+    - cache directory (except the testdata test cache and the runs report cache, unless keep_test_cache is False)
     - all .o files
     - all meta.txt files
     - __pycache__ directories (including in subdirs)
@@ -25,10 +25,23 @@ def clean():
     # Remove cache directory
     cache_dir = config.get_cache_dir_path()
     if os.path.exists(cache_dir):
-        shutil.rmtree(cache_dir)
+        if keep_test_cache:
+            for entry in os.listdir(cache_dir):
+                if entry in ("testdata", "runs"):
+                    continue
+                entry_path = os.path.join(cache_dir, entry)
+                if os.path.isdir(entry_path) and not os.path.islink(entry_path):
+                    shutil.rmtree(entry_path)
+                else:
+                    os.remove(entry_path)
+        else:
+            shutil.rmtree(cache_dir)
 
     # Remove all .o files
+    test_cache_dir = os.path.join(cache_dir, "testdata")
     for o_file in glob.glob("./**/*.o", recursive=True):
+        if keep_test_cache and os.path.abspath(o_file).startswith(test_cache_dir + os.sep):
+            continue
         os.remove(o_file)
 
     # Remove meta.txt files
@@ -12,6 +12,7 @@ class CommonConfig:
 
     testlib_gen_path: str = "gen.cpp"
     testlib_checker_path: str = ""  # Empty by default - no checker, use character comparison
+    testlib_validator_path: str = ""  # Empty by default - generated tests aren't validated
     testlib_header_path: str = "testlib.h"
 
     tests_dir: str = "./tests"
@@ -81,6 +82,11 @@ def override_checker_path(path):
     _conf.testlib_checker_path = _require_existing_file(path, "testlib checker")
     return _conf.testlib_checker_path
 
+def override_validator_path(path):
+    global _conf
+    _conf.testlib_validator_path = _require_existing_file(path, "testlib validator")
+    return _conf.testlib_validator_path
+
 def enable_checker():
     global _conf
     _conf.testlib_checker_path = "checker.cpp"
@@ -136,6 +142,14 @@ def get_testlib_checker_path() -> Optional[str]:
     return _conf.testlib_checker_path
 
 
+def get_testlib_validator_path() -> Optional[str]:
+    global _conf
+    if not _conf.testlib_validator_path:
+        return None
+    _conf.testlib_validator_path = _require_existing_file(_conf.testlib_validator_path, "testlib validator")
+    return _conf.testlib_validator_path
+
+
 def get_testlib_header_path() -> str:
     global _conf
     _conf.testlib_header_path = _require_existing_file(_conf.testlib_header_path, "testlib header")
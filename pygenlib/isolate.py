@@ -1,12 +1,17 @@
-import hashlib
+import contextlib
 from dataclasses import dataclass
+from typing import Optional
 import os
+import queue
 import subprocess
 import tempfile
+import threading
+import time
 import shutil
 import logging
 
-from pygenlib import config
+from pygenlib import trace
+from pygenlib.build import compile_cpp
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
@@ -23,10 +28,24 @@ class IsolateResult:
     killed: bool  # Whether process was killed
     max_rss_kib: int  # Peak memory usage in KB
     cg_mem_kib: int  # Memory usage reported by cgroups
+    stdout_path: Optional[str] = None  # File holding stdout when it was redirected (stdout is "" then)
+    oom_killed: bool = False  # Killed by the cgroup memory limit (memory_limit_kib)
+    memory_limit_kib: Optional[int] = None  # cgroup memory limit the program ran with, None for none
+    time_limit: Optional[float] = None  # CPU time limit isolate kills the program at (--time)
+    memory_samples: Optional[list] = None  # [seconds since start, KiB in use] pairs, see MemorySampler
+
+# Names of the redirected stdin/stdout files inside the box directory
+_BOX_STDIN = ".pygenlib.stdin"
+_BOX_STDOUT = ".pygenlib.stdout"
 
 def run_cmd_in_isolate(command: str, 
                           isolate_args: dict = None,
-                          stdin: str = "", box_path: str = None, time_limit: float = 5.0) -> IsolateResult:
+                          stdin: str = "", box_path: str = None, time_limit: float = 5.0,
+                          box_id: int = 0, cleanup: bool = True,
+                          stdin_path: str = None, stdout_path: str = None,
+                          cpu: Optional[int] = None,
+                          stdin_fd: Optional[int] = None, stdout_fd: Optional[int] = None,
+                          memory_limit_kib: Optional[int] = None, sample_memory: bool = False) -> IsolateResult:
     """Run arbitrary command in IOI isolate sandbox
     
     Args:
@@ -43,8 +62,20 @@ def run_cmd_in_isolate(command: str,
                 "envs": {"HOME": "/box", "PATH": None}  # Environment vars
             }
         stdin: Input to feed to program
+        box_id: Isolate box to use (--box-id), concurrent runs need distinct ids
+        cleanup: Whether to run isolate --cleanup afterwards (False for boxes owned by a SandboxPool)
+        stdin_path: Host file to use as stdin instead of stdin, it is hard-linked
+            (or copied across filesystems) into the box and passed with --stdin
+        stdout_path: Host file to move the program's stdout to, isolate writes it
+            inside the box with --stdout and result.stdout stays empty
+        cpu: Pin isolate and the program to this CPU core (taskset), so concurrent boxes don't compete for a core
+        stdin_fd, stdout_fd: Host file descriptor (e.g. a pipe end) isolate passes to the program as stdin/stdout,
+            instead of stdin/stdin_path and result.stdout/stdout_path. The caller keeps ownership of the descriptor.
+        memory_limit_kib: Memory limit of the box's cgroup (--cg-mem), the program is killed when it uses more
+            and result.oom_killed is set
+        sample_memory: Record the box's memory use during the run in result.memory_samples
     """
-    logger.debug(f"Running command in isolate: {command}")
+    logger.debug(f"Running command in isolate box {box_id}: {command}")
     
     # Use default isolate arguments if none provided
     default_args = {
@@ -58,6 +89,9 @@ def run_cmd_in_isolate(command: str,
         "envs": {"HOME": "/box", "PATH": None}
     }
     
+    if memory_limit_kib is not None:
+        default_args["cg-mem"] = memory_limit_kib
+
     if isolate_args is None:
         isolate_args = default_args
     else:
@@ -70,22 +104,18 @@ def run_cmd_in_isolate(command: str,
 
     # Start sandbox and get path
     if box_path is None:
-        init_proc = subprocess.run(['isolate', '--init', '--cg'], 
-                             capture_output=True, text=True)
-        if init_proc.returncode != 0:
-            logger.error(f"Failed to initialize isolate: {init_proc.stderr}")
-        raise RuntimeError(f"Failed to initialize isolate: {init_proc.stderr}")
-    
-        box_path = init_proc.stdout.strip()
-        logger.debug(f"Initialized sandbox at: {box_path}")
+        box_path = _init_sandbox(box_id)
     
     try:
         # Build isolate command with parameters
-        run_cmd = ["isolate", "--cg"]
+        # Every box id has its own isolate cgroup, so concurrent runs are accounted separately
+        run_cmd = ["isolate", f"--box-id={box_id}", "--cg"]
+        if cpu is not None:
+            run_cmd = ["taskset", "--cpu-list", str(cpu)] + run_cmd
         
         if isolate_args:
             # Add numeric parameters
-            for param in ["mem", "time", "extra-time", "wall-time", "processes", "open-files"]:
+            for param in ["mem", "cg-mem", "time", "extra-time", "wall-time", "processes", "open-files"]:
                 if param in isolate_args:
                     run_cmd.extend([f"--{param}={isolate_args[param]}"])
             
@@ -102,51 +132,197 @@ def run_cmd_in_isolate(command: str,
                     else:
                         run_cmd.extend([f"--env={env_name}={env_value}"])
         
-        # Add meta file
-        meta_path = os.path.join("meta.txt")
+        # Add meta file, unique per run so that concurrent boxes don't share it
+        meta_fd, meta_path = tempfile.mkstemp(prefix=f"meta-{box_id}-", suffix=".txt")
+        os.close(meta_fd)
         run_cmd.extend(["-M", meta_path])
+
+        # Redirect through files in the box, so test data doesn't pass through Python
+        if stdin_path is not None:
+            _link_into_box(stdin_path, os.path.join(box_path, "box", _BOX_STDIN))
+            run_cmd.append(f"--stdin={_BOX_STDIN}")
+        if stdout_path is not None:
+            run_cmd.append(f"--stdout={_BOX_STDOUT}")
         
         # Add command to execute
         run_cmd.extend(["-s", "--run", "--", f'/usr/bin/bash', '-c', f'{command}'])
         
         logger.debug(f"Running isolate command: {run_cmd}")
-        run_proc = subprocess.run(run_cmd,
-                                input=stdin,
-                                capture_output=True,
-                                text=True)
-
-        # Parse meta file (same as before)
-        meta = {}
-        if os.path.exists(meta_path):
-            with open(meta_path) as f:
-                for line in f:
-                    if ":" in line:
-                        key, value = line.strip().split(":", 1)
-                        meta[key] = value
+        # Without --stdin/--stdout the program inherits isolate's own stdin/stdout
+        if stdin_fd is not None:
+            run_stdin = stdin_fd
+        elif stdin_path is not None:
+            run_stdin = subprocess.DEVNULL
+        else:
+            run_stdin = None
+        if stdout_fd is not None:
+            run_stdout = stdout_fd
+        elif stdout_path is not None:
+            run_stdout = subprocess.DEVNULL
+        else:
+            run_stdout = subprocess.PIPE
+        with trace.span("isolate.run", "isolate", box=box_id, command=command[:200]) as run_span:
+            run_proc = subprocess.Popen(run_cmd,
+                                        stdin=subprocess.PIPE if run_stdin is None else run_stdin,
+                                        stdout=run_stdout,
+                                        stderr=subprocess.PIPE,
+                                        text=True)
+            sampler = MemorySampler(box_id, run_proc.pid) if sample_memory else None
+            try:
+                run_stdout_text, run_stderr_text = run_proc.communicate(stdin if run_stdin is None else None)
+            finally:
+                if sampler is not None:
+                    sampler.stop()
+            if stdout_path is not None:
+                _move_from_box(os.path.join(box_path, "box", _BOX_STDOUT), stdout_path)
+
+            # Parse meta file (same as before)
+            meta = {}
+            if os.path.exists(meta_path):
+                with open(meta_path) as f:
+                    for line in f:
+                        if ":" in line:
+                            key, value = line.strip().split(":", 1)
+                            meta[key] = value
         
-        os.remove(meta_path)
-        result = IsolateResult(
-            stdout=run_proc.stdout,
-            stderr=run_proc.stderr,
-            exit_code=run_proc.returncode,
-            exec_time=float(meta.get("time", "0")),
-            wall_time=float(meta.get("time-wall", "0")),
-            status=meta.get("status", "OK"),
-            killed=meta.get("killed", "0") == "1",
-            max_rss_kib=int(meta.get("max-rss", "0")),
-            cg_mem_kib=int(meta.get("cg-mem", "0"))
-        )
-        logger.debug(f"Command completed with status: {result.status}, exit code: {result.exit_code}")
+            os.remove(meta_path)
+            result = IsolateResult(
+                stdout=run_stdout_text or "",
+                stderr=run_stderr_text,
+                exit_code=run_proc.returncode,
+                exec_time=float(meta.get("time", "0")),
+                wall_time=float(meta.get("time-wall", "0")),
+                status=meta.get("status", "OK"),
+                killed=meta.get("killed", "0") == "1",
+                max_rss_kib=int(meta.get("max-rss", "0")),
+                cg_mem_kib=int(meta.get("cg-mem", "0")),
+                stdout_path=stdout_path,
+                oom_killed=meta.get("cg-oom-killed", "0") == "1",
+                memory_limit_kib=memory_limit_kib,
+                time_limit=float(isolate_args["time"]) if "time" in isolate_args else None,
+                memory_samples=sampler.samples if sampler is not None else None,
+            )
+            logger.debug(f"Command completed with status: {result.status}, exit code: {result.exit_code}")
+            run_span["status"] = result.status
+            run_span["bytes"] = trace.file_size(stdout_path) if stdout_path is not None else len(result.stdout)
         return result
     finally:
-        logger.debug("Cleaning up sandbox")
-        subprocess.run(["isolate", "--cleanup", "--cg"])
+        if cleanup:
+            _cleanup_sandbox(box_id)
+
+# Where isolate 2 (cgroup v2) keeps the path of its cgroup root (cg_root = auto:/run/isolate/cgroup)
+_ISOLATE_CG_ROOT_FILE = "/run/isolate/cgroup"
+# cgroup v1 memory controller, used by isolate 1
+_CG_V1_MEMORY_ROOT = "/sys/fs/cgroup/memory"
+
+
+class MemorySampler:
+    """Samples the memory use of a box every interval seconds while its program runs.
+
+    Reads the box's cgroup (memory.current, or memory.usage_in_bytes on cgroup v1), which is
+    what --cg-mem limits. Without a readable cgroup the resident set sizes of the processes
+    below the isolate process pid are summed instead.
+    samples grows to [[seconds since start, KiB], ...] until stop() is called.
+    """
+
+    def __init__(self, box_id: int, pid: int, interval: float = 0.01):
+        self.box_id = box_id
+        self.pid = pid
+        self.interval = interval
+        self.samples: list[list] = []
+        self._counter_path: Optional[str] = None
+        self._page_kib = os.sysconf("SC_PAGE_SIZE") // 1024
+        self._stopped = threading.Event()
+        self._thread = threading.Thread(target=self._run, name=f"memory-box-{box_id}", daemon=True)
+        self._thread.start()
+
+    def stop(self):
+        self._stopped.set()
+        self._thread.join()
+
+    def _run(self):
+        start = time.monotonic()
+        while True:
+            kib = self._read_kib()
+            if kib is not None:
+                self.samples.append([round(time.monotonic() - start, 4), kib])
+            if self._stopped.wait(self.interval):
+                return
+
+    def _read_kib(self) -> Optional[int]:
+        if self._counter_path is None:
+            self._counter_path = self._find_counter()
+        if self._counter_path:
+            try:
+                with open(self._counter_path) as f:
+                    return int(f.read()) // 1024
+            except (OSError, ValueError):
+                # The box cgroup is recreated at the start of the run
+                self._counter_path = None
+        return self._process_tree_kib()
 
-def _init_sandbox() -> str:
+    def _find_counter(self) -> str:
+        candidates = [os.path.join(_CG_V1_MEMORY_ROOT, f"box-{self.box_id}", "memory.usage_in_bytes")]
+        try:
+            with open(_ISOLATE_CG_ROOT_FILE) as f:
+                candidates.insert(0, os.path.join(f.read().strip(), f"box-{self.box_id}", "memory.current"))
+        except OSError:
+            pass
+        return next((path for path in candidates if os.access(path, os.R_OK)), "")
+
+    def _process_tree_kib(self) -> Optional[int]:
+        pids = self._children(self.pid)
+        total = 0
+        while pids:
+            pid = pids.pop()
+            pids.extend(self._children(pid))
+            try:
+                with open(f"/proc/{pid}/statm") as f:
+                    total += int(f.read().split()[1]) * self._page_kib
+            except (OSError, ValueError, IndexError):
+                pass  # exited meanwhile
+        return total or None
+
+    @staticmethod
+    def _children(pid: int) -> list[int]:
+        try:
+            with open(f"/proc/{pid}/task/{pid}/children") as f:
+                return [int(child) for child in f.read().split()]
+        except (OSError, ValueError):
+            return []
+
+
+def _link_into_box(src_path: str, box_file: str):
+    """Hard-link src_path into the box, copying when the box is on another filesystem"""
+    if os.path.lexists(box_file):
+        os.remove(box_file)
+    try:
+        os.link(src_path, box_file)
+    except OSError:
+        shutil.copyfile(src_path, box_file)
+
+def _move_from_box(box_file: str, dst_path: str):
+    """Move a file written by the sandboxed program out of the box"""
+    if not os.path.exists(box_file):
+        # Isolate failed before opening --stdout
+        open(dst_path, "w").close()
+        return
+    try:
+        os.replace(box_file, dst_path)
+    except OSError:
+        shutil.copyfile(box_file, dst_path)
+        os.remove(box_file)
+
+def _cleanup_sandbox(box_id: int = 0):
+    logger.debug(f"Cleaning up sandbox {box_id}")
+    subprocess.run(["isolate", f"--box-id={box_id}", "--cleanup", "--cg"])
+
+def _init_sandbox(box_id: int = 0) -> str:
     """Initialize isolate sandbox and return box path and stdin path"""
-    logger.debug("Initializing sandbox")
-    init_proc = subprocess.run(['isolate', '--init', '--cg'], 
-                             capture_output=True, text=True)
+    logger.debug(f"Initializing sandbox {box_id}")
+    with trace.span("isolate.init", "isolate", box=box_id):
+        init_proc = subprocess.run(['isolate', f'--box-id={box_id}', '--init', '--cg'],
+                                   capture_output=True, text=True)
     if init_proc.returncode != 0:
         logger.error(f"Failed to initialize isolate: {init_proc.stderr}")
         raise RuntimeError(f"Failed to initialize isolate: {init_proc.stderr}")
@@ -156,7 +332,129 @@ def _init_sandbox() -> str:
     return box_path
 
 
-def run_cpp_code(source_code: str, stdin: str, time_limit: float = 5.0, args: list = None, extra_compile_files: dict = None, extra_run_files: dict = None) -> IsolateResult:
+@dataclass
+class Sandbox:
+    """Isolate box initialized by a SandboxPool"""
+    box_id: int
+    box_path: str  # Path printed by isolate --init, files go to {box_path}/box
+    cpu: Optional[int] = None  # CPU core runs in this box are pinned to
+
+    def wipe(self):
+        """Remove files left in the box directory by the previous run."""
+        box_dir = os.path.join(self.box_path, "box")
+        try:
+            for entry in os.listdir(box_dir):
+                entry_path = os.path.join(box_dir, entry)
+                if os.path.isdir(entry_path) and not os.path.islink(entry_path):
+                    shutil.rmtree(entry_path)
+                else:
+                    os.remove(entry_path)
+        except OSError as exc:
+            # Files created by the sandboxed program may not be removable, start over
+            logger.debug(f"Reinitializing sandbox {self.box_id}: {exc}")
+            _cleanup_sandbox(self.box_id)
+            self.box_path = _init_sandbox(self.box_id)
+
+
+class SandboxPool:
+    """Isolate boxes that stay initialized between runs.
+
+    isolate --init/--cleanup run once per box instead of once per execution,
+    before each run only the box directory is wiped.
+
+    Usage:
+        with SandboxPool(range(4), cpus=pinned_cpus(4)) as pool:
+            with pool.sandbox() as sandbox:
+                run_cpp_code(code, stdin, sandbox=sandbox)
+    """
+
+    def __init__(self, box_ids=(0,), cpus=None):
+        """
+        Args:
+            box_ids: Isolate box ids to initialize.
+            cpus: Optional CPU core for each box (same order as box_ids), see pinned_cpus().
+        """
+        self.box_ids = list(box_ids)
+        if not self.box_ids:
+            raise ValueError("at least one isolate box id is required")
+        self.cpus = list(cpus) if cpus is not None else [None] * len(self.box_ids)
+        if len(self.cpus) != len(self.box_ids):
+            raise ValueError("cpus must have one entry per box id")
+        self._free: queue.Queue = queue.Queue()
+        self._acquire_many_lock = threading.Lock()
+        self._initialized: list[Sandbox] = []
+        try:
+            for box_id, cpu in zip(self.box_ids, self.cpus):
+                sandbox = Sandbox(box_id, _init_sandbox(box_id), cpu)
+                self._initialized.append(sandbox)
+                self._free.put(sandbox)
+        except Exception:
+            self.close()
+            raise
+
+    def __len__(self):
+        return len(self.box_ids)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def acquire(self) -> Sandbox:
+        """Take a free box, blocks until one is released."""
+        return self._free.get()
+
+    def release(self, sandbox: Sandbox):
+        self._free.put(sandbox)
+
+    def acquire_many(self, count: int) -> list[Sandbox]:
+        """Take count free boxes at once, blocks until they are available.
+
+        Callers taking several boxes queue up one at a time, so two of them never
+        deadlock holding one box each.
+        """
+        if count > len(self.box_ids):
+            raise ValueError(f"cannot take {count} boxes from a pool of {len(self.box_ids)}")
+        with self._acquire_many_lock:
+            return [self._free.get() for _ in range(count)]
+
+    @contextlib.contextmanager
+    def sandbox(self):
+        sandbox = self.acquire()
+        try:
+            yield sandbox
+        finally:
+            self.release(sandbox)
+
+    @contextlib.contextmanager
+    def sandboxes(self, count: int):
+        sandboxes = self.acquire_many(count)
+        try:
+            yield sandboxes
+        finally:
+            for sandbox in sandboxes:
+                self.release(sandbox)
+
+    def close(self):
+        """Clean up all boxes, the pool can't be used afterwards."""
+        for sandbox in self._initialized:
+            _cleanup_sandbox(sandbox.box_id)
+        self._initialized = []
+
+
+def pinned_cpus(count: int) -> list[int]:
+    """Return count distinct CPU cores this process may run on, for SandboxPool(cpus=...)"""
+    available = sorted(os.sched_getaffinity(0))
+    if count > len(available):
+        raise ValueError(f"cannot pin {count} boxes to {len(available)} available CPU cores")
+    return available[:count]
+
+
+def run_cpp_code(source_code: str, stdin: str, time_limit: float = 5.0, args: list = None, extra_compile_files: dict = None, extra_run_files: dict = None, box_id: int = 0, sandbox: Sandbox = None,
+                 stdin_path: str = None, stdout_path: str = None,
+                 stdin_fd: Optional[int] = None, stdout_fd: Optional[int] = None,
+                 memory_limit_kib: Optional[int] = None, sample_memory: bool = False) -> IsolateResult:
     """Run C++ code in IOI isolate sandbox.
     
     Args:
@@ -166,23 +464,16 @@ def run_cpp_code(source_code: str, stdin: str, time_limit: float = 5.0, args: li
         args: Command line arguments to pass to program
         extra_compile_files: Dictionary mapping filenames to file contents to include in compilation directory
         extra_run_files: Dictionary mapping filenames to file contents to include in run directory
+        box_id: Isolate box to run in
+        sandbox: Box acquired from a SandboxPool, used instead of initializing box_id
+        stdin_path: File to read stdin from instead of stdin
+        stdout_path: File to write stdout to instead of result.stdout
+        stdin_fd, stdout_fd: Pipe or file descriptor used as stdin/stdout, see run_cmd_in_isolate()
+        memory_limit_kib, sample_memory: cgroup memory limit and memory sampling, see run_cmd_in_isolate()
     """
     logger.debug("Running C++ code")
-    box_path = _init_sandbox()
-    
-    # Calculate checksum of source and additional files
-    m = hashlib.sha256()
-    m.update(source_code.encode())
-    if extra_compile_files:
-        for filename in sorted(extra_compile_files.keys()):
-            m.update(filename.encode())
-            m.update(extra_compile_files[filename].encode())
-    checksum = m.hexdigest()
-    
-    # Check cache directory
-    cache_dir = config.get_cache_dir_path()
-    os.makedirs(cache_dir, exist_ok=True)
-    cached_exe = os.path.join(cache_dir, checksum)
+    box_path, box_id = _prepare_sandbox(box_id, sandbox)
+    cpu = sandbox.cpu if sandbox is not None else None
     
     def _write_run_files():
         if not extra_run_files:
@@ -198,67 +489,35 @@ def run_cpp_code(source_code: str, stdin: str, time_limit: float = 5.0, args: li
             if not os.path.exists(file_path):
                 raise FileNotFoundError(f"Extra run file not found: {file_path}")
 
-    if os.path.exists(cached_exe):
-        logger.debug("Found cached executable")
-        # Copy from cache to sandbox
-        box_exe_path = os.path.join(box_path, "box", "solution")
-        shutil.copy2(cached_exe, box_exe_path)
-        assert os.path.exists(box_exe_path)
-        _write_run_files()
-        return run_cmd_in_isolate(f"./solution {' '.join(args) if args else ''}", None, stdin, box_path=box_path, time_limit=time_limit)
-    
-    with tempfile.TemporaryDirectory() as tmpdir:
-        # Set up compilation
-        src_path = os.path.join(tmpdir, "solution.cpp")
-        exe_name = "solution"
-        
-        # Write source
-        logger.debug(f"Writing source to {src_path}")
-        with open(src_path, "w") as f:
-            f.write(source_code)
+    cached_exe = compile_cpp(source_code, extra_compile_files)
 
-        # Write any additional files
-        if extra_compile_files:
-            for filename, content in extra_compile_files.items():
-                file_path = os.path.join(tmpdir, filename)
-                logger.debug(f"Writing additional file: {file_path}")
-                with open(file_path, "w") as f:
-                    f.write(content)
-
-        # Compile
-        logger.debug("Compiling C++ code")
-        compile_cmd = ["g++", "-O2", "-std=c++17", src_path, "-o", 
-                        os.path.join(tmpdir, exe_name)]
-        
-        compile_proc = subprocess.run(compile_cmd,
-                                      cwd=tmpdir,
-                                    capture_output=True,
-                                    text=True)
-        if compile_proc.returncode != 0:
-            logger.error(f"Compilation failed: {compile_proc.stderr}")
-            raise RuntimeError(f"Compilation failed: {compile_proc.stderr}")
-
-        # Cache the executable
-        logger.debug(f"Caching executable to {cached_exe}")
-        shutil.copy2(os.path.join(tmpdir, exe_name), cached_exe)
-
-        # Move executable to sandbox
-        box_exe_path = os.path.join(box_path, "box", exe_name)
-        logger.debug(f"Moving executable to sandbox: {box_exe_path}")
-        shutil.copy2(os.path.join(tmpdir, exe_name), box_exe_path)
+    # Copy from cache to sandbox
+    box_exe_path = os.path.join(box_path, "box", "solution")
+    shutil.copy2(cached_exe, box_exe_path)
+    assert os.path.exists(box_exe_path)
+    _write_run_files()
+    return run_cmd_in_isolate(f"./solution {' '.join(args) if args else ''}", None, stdin, box_path=box_path, time_limit=time_limit, box_id=box_id, cleanup=sandbox is None,
+                              stdin_path=stdin_path, stdout_path=stdout_path, cpu=cpu,
+                              stdin_fd=stdin_fd, stdout_fd=stdout_fd,
+                              memory_limit_kib=memory_limit_kib, sample_memory=sample_memory)
 
-        # make sure that the executable is in the box
-        assert os.path.exists(box_exe_path)
 
-        # Copy extra files to sandbox
-        _write_run_files()
+def _prepare_sandbox(box_id: int, sandbox: Sandbox = None):
+    """Return (box_path, box_id) of a pooled box or of a freshly initialized one"""
+    if sandbox is None:
+        return _init_sandbox(box_id), box_id
+    sandbox.wipe()
+    return sandbox.box_path, sandbox.box_id
 
-        return run_cmd_in_isolate(f"./{exe_name} {' '.join(args) if args else ''}", None, stdin, box_path=box_path, time_limit=time_limit)
 
-def run_py_code(source_code: str, stdin: str, time_limit: float = 5.0, extra_args: list = None) -> IsolateResult:
-    """Run Python code in IOI isolate sandbox"""
+def run_py_code(source_code: str, stdin: str, time_limit: float = 5.0, extra_args: list = None, box_id: int = 0, sandbox: Sandbox = None,
+                stdin_path: str = None, stdout_path: str = None,
+                stdin_fd: Optional[int] = None, stdout_fd: Optional[int] = None,
+                memory_limit_kib: Optional[int] = None, sample_memory: bool = False) -> IsolateResult:
+    """Run Python code in IOI isolate sandbox, the other arguments as in run_cpp_code()"""
     logger.debug("Running Python code")
-    box_path = _init_sandbox()
+    box_path, box_id = _prepare_sandbox(box_id, sandbox)
+    cpu = sandbox.cpu if sandbox is not None else None
     
     with tempfile.TemporaryDirectory() as tmpdir:
         # Set up file
@@ -279,4 +538,7 @@ def run_py_code(source_code: str, stdin: str, time_limit: float = 5.0, extra_arg
         cmd = ["python3"]
         cmd.append(exe_name)
         
-        return run_cmd_in_isolate(f"{' '.join(cmd)} {' '.join(extra_args) if extra_args else ''}", None, stdin, box_path=box_path, time_limit=time_limit)
+        return run_cmd_in_isolate(f"{' '.join(cmd)} {' '.join(extra_args) if extra_args else ''}", None, stdin, box_path=box_path, time_limit=time_limit, box_id=box_id, cleanup=sandbox is None,
+                                  stdin_path=stdin_path, stdout_path=stdout_path, cpu=cpu,
+                              stdin_fd=stdin_fd, stdout_fd=stdout_fd,
+                              memory_limit_kib=memory_limit_kib, sample_memory=sample_memory)
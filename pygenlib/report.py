@@ -1,15 +1,26 @@
-from dataclasses import dataclass
-from typing import Optional, Tuple
-
-from pygenlib.isolate import run_cpp_code, run_py_code
-from pygenlib import config
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import asdict, dataclass, field
+from typing import Callable, Iterable, Optional
+
+from pygenlib.build import compile_cpp, prepare_extra_files
+from pygenlib.calibrate import TimeNormalization, calibrate, load_calibration
+from pygenlib.isolate import IsolateResult, Sandbox, SandboxPool, pinned_cpus, run_cpp_code, run_py_code
+from pygenlib import config, trace
+from pygenlib.runcache import RunCache, RunRecord
+from pygenlib.testpack import PlainCopies, is_compressed, open_plain, open_stdin, plain_name, plain_size
+from pygenlib.tgyaml import read_task_yaml, read_testgroups
 import csv
+import functools
+import itertools
+import json
 import logging
 import os
-import shutil
+import re
+import select
+import signal
 import tempfile
+import threading
 import subprocess
-import hashlib
 
 logger = logging.getLogger(__name__)
 
@@ -18,11 +29,19 @@ logger = logging.getLogger(__name__)
 class TestCaseResult:
     """Result of running a solution on a test case"""
 
-    verdict: str  # "AC", "WA", "TLE", or "RE"
+    verdict: str  # "AC", "WA", "PC", "TLE", "MLE", "RE", "FAIL" (checker failure, not the solution's fault)
+                  # or "SKIP" (not run, an earlier test of the testgroup failed)
     exec_time: float  # CPU time in seconds
     mem_mib: float  # Memory usage in MiB
     test_name: str  # Test case name without task prefix
     checker_msg: str = ""  # Output message from the checker
+    checker_points: Optional[float] = None  # Points reported by a quitp() checker
+    checker_time: float = 0.0  # Checker CPU time in seconds
+    checker_mem_mib: float = 0.0  # Checker peak memory in MiB
+    wall_time: float = 0.0  # Wall clock time in seconds
+    max_rss_mib: float = 0.0  # Peak resident set size in MiB
+    memory_samples: Optional[list] = None  # [seconds, KiB] memory use during the run, with memory_profile
+    alloc_time: Optional[float] = None  # Seconds until the memory use first reached 90% of its peak
 
 
 @dataclass
@@ -33,6 +52,17 @@ class ReporterConfig:
     testlib_path: str
     cache_dir: str
     reports_dir: str
+    time_limit: Optional[float] = None  # Seconds, None takes time_limit from task_yaml_path (or 1 second)
+    memory_limit: Optional[float] = None  # MiB, None takes memory_limit from task_yaml_path (or no limit)
+    task_yaml_path: Optional[str] = None  # task.yaml with time_limit, memory_limit, ...
+    incremental: bool = True  # Reuse runs and checker verdicts from {cache_dir}/runs, see RunCache
+    memory_profile: bool = False  # Sample the memory use of every run, see _write_memory_profile()
+    early_abort: bool = False  # Skip the rest of a testgroup after its first failed test, see report()
+    score: bool = False  # Score the report with tests_groups and subtask_points of task_yaml_path, see _write_score()
+    checker_extra_files: dict[str, str] = field(default_factory=dict)  # Headers of the checker, file path or contents
+    calibrate: bool = False  # Add the [norm] column, CPU time in units of the host calibration (see calibrate)
+    judge_calibration: Optional[str] = None  # Calibration JSON of the judge, adds [judge sec] and [tl margin]
+    compare_outputs: bool = True  # AC without running the checker when the output matches the answer, see CheckerServer
 
 
 _default_reporter_config: Optional[ReporterConfig] = None
@@ -43,42 +73,346 @@ def override_reporter_config(cfg: ReporterConfig):
     _default_reporter_config = cfg
 
 
-def report(sol_path, output_file=None, cfg: Optional[ReporterConfig] = None):
-    """Generate a TSV report for the provided solution path."""
+def report(sol_path, output_file=None, cfg: Optional[ReporterConfig] = None, pool: Optional[SandboxPool] = None):
+    """Generate a TSV report for the provided solution path.
+
+    The solution runs in a box from pool; without a pool, box 0 is initialized
+    once for the whole report.
+    With cfg.incremental only tests whose input or solution changed since the last report are run,
+    the other results are rebuilt from {cache_dir}/runs; outputs are re-checked when the checker or the answer changed.
+    Runs exceeding the memory limit (cfg.memory_limit or memory_limit of cfg.task_yaml_path) are MLE;
+    with cfg.memory_profile the per-testgroup peaks go to {output_file without .tsv}_memory.tsv.
+
+    With cfg.early_abort tests run testgroup by testgroup (the group number of task.i01a is 01), cheapest
+    group first and the largest test of a group first; once a test is not AC the group is lost and its
+    remaining tests are reported as SKIP. With cfg.score the points of the passed testgroups are added up
+    per subtask into {output_file without .tsv}_score.tsv.
+
+    With cfg.calibrate or cfg.judge_calibration the host is calibrated once (cached in {cache_dir}/calibration)
+    and the report gets CPU times normalized by the host's calibration and, with a judge calibration,
+    the estimated judge time and its margin to the time limit.
+    """
     cfg = _resolve_reporter_config(cfg)
     lang = _detect_language(sol_path)
     checker_executable = _compile_checker(cfg) if cfg.checker_path else None
     include_checker_msg = checker_executable is not None
+    time_limit = _resolve_time_limit(cfg)
+    memory_limit = _resolve_memory_limit(cfg)
 
     logger.debug(f"Generating report for solution: {sol_path}")
     if checker_executable:
         logger.debug(f"Using checker executable: {checker_executable}")
 
-    with open(sol_path, "r") as f:
-        sol_code = f.read()
-        logger.debug(f"Read solution code from {sol_path}, size: {len(sol_code)} bytes")
+    sol_code = _read_solution(sol_path)
 
     output_path = _resolve_output_path(sol_path, output_file, cfg)
     os.makedirs(os.path.dirname(output_path) or ".", exist_ok=True)
-    _initialize_report_file(output_path, include_checker_msg)
 
-    test_files = sorted(
-        f for f in os.listdir(cfg.tests_dir) if f.startswith(f"{cfg.task_name}.i")
-    )
-    logger.debug(f"Found {len(test_files)} test files to process")
+    test_files = _list_test_files(cfg)
 
-    for test_file in test_files:
+    own_pool = pool is None
+    if own_pool:
+        pool = SandboxPool()
+    timing = _resolve_time_normalization(cfg, pool)
+    _initialize_report_file(output_path, include_checker_msg, timing)
+    checker = CheckerServer(checker_executable, compare_first=cfg.compare_outputs) if checker_executable else None
+    run_cache = _resolve_run_cache(cfg)
+
+    def run_one(test_file: str) -> TestCaseResult:
         full_test_path = os.path.join(cfg.tests_dir, test_file)
         logger.debug(f"Running test: {test_file}")
-        result = _run_test(
-            full_test_path,
-            sol_code,
-            lang,
-            checker_executable,
-        )
-        _append_result(output_path, result, include_checker_msg)
+        with pool.sandbox() as sandbox:
+            return _run_test(
+                full_test_path,
+                sol_code,
+                lang,
+                checker,
+                sandbox,
+                time_limit,
+                run_cache,
+                memory_limit,
+                cfg.memory_profile,
+            )
+
+    results = []
+    try:
+        if cfg.early_abort:
+            by_test = {}
+            for group_files in _plan_testgroups(cfg, test_files):
+                by_test.update(_run_testgroup(group_files, run_one))
+            results = [by_test[test_file] for test_file in test_files]
+            for result in results:
+                _append_result(output_path, result, include_checker_msg, timing, time_limit)
+        else:
+            for test_file in test_files:
+                result = run_one(test_file)
+                _append_result(output_path, result, include_checker_msg, timing, time_limit)
+                results.append(result)
+    finally:
+        if own_pool:
+            pool.close()
+        if checker is not None:
+            checker.close()
 
     logger.debug(f"Results written to {output_path}")
+    if cfg.memory_profile:
+        _write_memory_profile(output_path, results, memory_limit)
+    if cfg.score:
+        _write_score(output_path, results, cfg)
+
+
+def report_all(sol_paths: Iterable[str], cfg: Optional[ReporterConfig] = None, workers: Optional[int] = None,
+               box_ids: Optional[Iterable[int]] = None, pool: Optional[SandboxPool] = None):
+    """Generate TSV reports for several solutions, running (solution, test) pairs in parallel.
+
+    Every pair runs in its own box of the pool. Boxes created here are pinned to
+    distinct CPU cores (and each box id has its own isolate cgroup), so concurrent
+    runs don't distort exec_time. Each solution gets the same TSV as report(sol_path).
+    Pairs are started test by test, so the checker server checks all solutions of a
+    test while its parsed input is still cached. Runs are reused from {cache_dir}/runs like in report().
+    Memory limit, cfg.memory_profile, cfg.early_abort, cfg.score and calibration as in report(); with early abort a
+    (solution, testgroup) pair runs in one box at a time, the cheapest groups of all solutions first.
+
+    Args:
+        sol_paths: Solutions to report on, reports go to the default report() paths.
+        cfg: Reporter configuration, resolved like in report() when omitted.
+        workers: Number of runs at once. Defaults to the number of available CPU cores.
+        box_ids: Isolate box ids to use. Defaults to 0..workers-1.
+        pool: Existing SandboxPool to run in (workers and box_ids are ignored then).
+    """
+    cfg = _resolve_reporter_config(cfg)
+    sol_paths = list(sol_paths)
+    checker_executable = _compile_checker(cfg) if cfg.checker_path else None
+    include_checker_msg = checker_executable is not None
+    time_limit = _resolve_time_limit(cfg)
+    memory_limit = _resolve_memory_limit(cfg)
+
+    solutions = [(sol_path, _read_solution(sol_path), _detect_language(sol_path)) for sol_path in sol_paths]
+    test_files = _list_test_files(cfg)
+
+    own_pool = pool is None
+    if own_pool:
+        if box_ids is None:
+            box_ids = range(workers or len(os.sched_getaffinity(0)))
+        box_ids = list(box_ids)
+        pool = SandboxPool(box_ids, cpus=pinned_cpus(len(box_ids)))
+    logger.info(
+        f"Reporting {len(solutions)} solutions on {len(test_files)} tests using {len(pool)} isolate boxes"
+    )
+    timing = _resolve_time_normalization(cfg, pool)
+
+    checker = CheckerServer(checker_executable, compare_first=cfg.compare_outputs) if checker_executable else None
+    run_cache = _resolve_run_cache(cfg)
+
+    def run_pair(sol_code: str, lang: str, test_file: str) -> TestCaseResult:
+        with pool.sandbox() as sandbox:
+            return _run_test(os.path.join(cfg.tests_dir, test_file), sol_code, lang, checker, sandbox, time_limit,
+                             run_cache, memory_limit, cfg.memory_profile)
+
+    try:
+        with ThreadPoolExecutor(max_workers=len(pool)) as executor:
+            futures = [[] for _ in solutions]
+            if cfg.early_abort:
+                for group_files in _plan_testgroups(cfg, test_files):
+                    for sol_index, (_, sol_code, lang) in enumerate(solutions):
+                        futures[sol_index].append(executor.submit(
+                            _run_testgroup, group_files, functools.partial(run_pair, sol_code, lang)))
+            else:
+                for test_file in test_files:
+                    for sol_index, (_, sol_code, lang) in enumerate(solutions):
+                        futures[sol_index].append(executor.submit(run_pair, sol_code, lang, test_file))
+            try:
+                for (sol_path, _, _), sol_futures in zip(solutions, futures):
+                    if cfg.early_abort:
+                        by_test = {}
+                        for future in sol_futures:
+                            by_test.update(future.result())
+                        results = [by_test[test_file] for test_file in test_files]
+                    else:
+                        results = [future.result() for future in sol_futures]
+                    output_path = _resolve_output_path(sol_path, None, cfg)
+                    os.makedirs(os.path.dirname(output_path) or ".", exist_ok=True)
+                    _initialize_report_file(output_path, include_checker_msg, timing)
+                    for result in results:
+                        _append_result(output_path, result, include_checker_msg, timing, time_limit)
+                    logger.debug(f"Results written to {output_path}")
+                    if cfg.memory_profile:
+                        _write_memory_profile(output_path, results, memory_limit)
+                    if cfg.score:
+                        _write_score(output_path, results, cfg)
+            except BaseException:
+                for sol_futures in futures:
+                    for future in sol_futures:
+                        future.cancel()
+                raise
+    finally:
+        if own_pool:
+            pool.close()
+        if checker is not None:
+            checker.close()
+
+
+class CheckerServer:
+    """testlib checker started in server mode (checker --server, see registerTestlibCmd in testlib.h).
+
+    Saves a process launch per check; checkers calling checker.inputRead() also parse each
+    input only once per server process for all solutions. A server answers one request at a time,
+    so concurrent checks go to separate server processes, started on demand up to max_servers.
+    A check prefers an idle process that has recently checked the same input.
+    Compressed input and answer files are checked through decompressed copies (see PlainCopies).
+
+    With compare_first an output that matches the answer (see _outputs_match()) is accepted without
+    asking the checker, which then can't report the jury's errors or points below the maximum for it.
+    """
+
+    def __init__(self, checker_executable: str, timeout: float = 5.0, compare_first: bool = True,
+                 max_servers: Optional[int] = None):
+        self.checker_executable = checker_executable
+        self.timeout = timeout
+        self.compare_first = compare_first
+        self.max_servers = max_servers or os.cpu_count() or 1
+        self._lock = threading.Lock()
+        self._idle_changed = threading.Condition(self._lock)
+        self._idle: list[_ServerProcess] = []
+        self._started = 0  # Server processes alive, idle or checking
+        self._plain_copies = PlainCopies()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def check(self, input_file: str, participant_path: str, jury_path: str) -> dict:
+        """Check one output, returns the checker's JSON verdict.
+
+        Keys: verdict (OK, WA, PE, FAIL, POINTS, PARTIALLY, UNEXPECTED_EOF), exit_code, message,
+        points or pctype when given, time and wall_time in seconds, memory_kib (peak RSS).
+        """
+        with self._plain_copies.plain(input_file) as input_file, self._plain_copies.plain(jury_path) as jury_path:
+            return self._check(input_file, participant_path, jury_path)
+
+    def _check(self, input_file: str, participant_path: str, jury_path: str) -> dict:
+        files = [os.path.abspath(path) for path in (input_file, participant_path, jury_path)]
+        if any("\t" in path or "\n" in path for path in files):
+            raise ValueError(f"Checker server can't pass file paths with tabs or newlines: {files}")
+
+        server = self._acquire(files[0])
+        try:
+            try:
+                server.proc.stdin.write("\t".join(files) + "\n")
+                server.proc.stdin.flush()
+            except BrokenPipeError:
+                self._kill(server)
+                raise RuntimeError("Checker server exited")
+
+            ready, _, _ = select.select([server.proc.stdout], [], [], self.timeout)
+            if not ready:
+                self._kill(server)
+                raise subprocess.TimeoutExpired(self.checker_executable, self.timeout)
+            line = server.proc.stdout.readline()
+            if not line:
+                self._kill(server)
+                raise RuntimeError("Checker server exited")
+            return json.loads(line)
+        finally:
+            self._release(server)
+
+    def _acquire(self, input_file: str) -> "_ServerProcess":
+        """An idle server process, the one that checked input_file most recently if any"""
+        with self._idle_changed:
+            while True:
+                # A process that exited since its last check is replaced
+                alive = [server for server in self._idle if server.proc.poll() is None]
+                self._started -= len(self._idle) - len(alive)
+                self._idle = alive
+                if self._idle:
+                    server = max(self._idle, key=lambda idle: idle.recent_inputs.get(input_file, -1))
+                    self._idle.remove(server)
+                    break
+                if self._started < self.max_servers:
+                    server = self._start()
+                    self._started += 1
+                    break
+                self._idle_changed.wait()
+        server.use(input_file)
+        return server
+
+    def _release(self, server: "_ServerProcess"):
+        with self._idle_changed:
+            if server.proc is not None:
+                self._idle.append(server)
+            else:
+                self._started -= 1
+            self._idle_changed.notify()
+
+    def _start(self) -> "_ServerProcess":
+        logger.debug(f"Starting checker server: {self.checker_executable} --server")
+        return _ServerProcess(subprocess.Popen(
+            [self.checker_executable, "--server"],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            text=True,
+            start_new_session=True,  # so _kill() also stops the processes it forked
+        ))
+
+    def close(self):
+        """Stop the idle server processes, call it once the checks have finished"""
+        self._plain_copies.close()
+        with self._lock:
+            idle, self._idle = self._idle, []
+            self._started -= len(idle)
+        for server in idle:
+            server.proc.stdin.close()
+            try:
+                server.proc.wait(timeout=self.timeout)
+            except subprocess.TimeoutExpired:
+                self._kill(server)
+
+    @staticmethod
+    def _kill(server: "_ServerProcess"):
+        try:
+            os.killpg(server.proc.pid, signal.SIGKILL)
+        except ProcessLookupError:
+            pass
+        server.proc.wait()
+        server.proc = None
+
+
+class _ServerProcess:
+    """One checker --server process and the inputs it has parsed recently"""
+
+    def __init__(self, proc: subprocess.Popen):
+        self.proc: Optional[subprocess.Popen] = proc
+        self.recent_inputs: dict[str, int] = {}  # input path -> use counter, like TESTLIB_SERVER_CACHED_INPUTS
+        self._uses = 0
+
+    def use(self, input_file: str):
+        self._uses += 1
+        self.recent_inputs.pop(input_file, None)
+        self.recent_inputs[input_file] = self._uses
+        if len(self.recent_inputs) > _SERVER_CACHED_INPUTS:
+            del self.recent_inputs[next(iter(self.recent_inputs))]
+
+
+# Inputs a checker server keeps parsed (TESTLIB_SERVER_CACHED_INPUTS in testlib.h)
+_SERVER_CACHED_INPUTS = 8
+
+
+def _read_solution(sol_path: str) -> str:
+    with open(sol_path, "r") as f:
+        sol_code = f.read()
+    logger.debug(f"Read solution code from {sol_path}, size: {len(sol_code)} bytes")
+    return sol_code
+
+
+def _list_test_files(cfg: ReporterConfig) -> list[str]:
+    test_files = sorted(
+        f for f in os.listdir(cfg.tests_dir) if f.startswith(f"{cfg.task_name}.i")
+    )
+    logger.debug(f"Found {len(test_files)} test files to process")
+    return test_files
 
 
 def _resolve_reporter_config(reporter_config: Optional[ReporterConfig]) -> ReporterConfig:
@@ -96,6 +430,44 @@ def _resolve_reporter_config(reporter_config: Optional[ReporterConfig]) -> Repor
     )
 
 
+def _resolve_time_limit(cfg: ReporterConfig) -> float:
+    if cfg.time_limit is not None:
+        return cfg.time_limit
+    if cfg.task_yaml_path is not None:
+        time_limit = read_task_yaml(cfg.task_yaml_path).get("time_limit")
+        if time_limit is not None:
+            logger.debug(f"Time limit from {cfg.task_yaml_path}: {time_limit}s")
+            return float(time_limit)
+    return 1.0
+
+
+def _resolve_memory_limit(cfg: ReporterConfig) -> Optional[float]:
+    if cfg.memory_limit is not None:
+        return cfg.memory_limit
+    if cfg.task_yaml_path is not None:
+        memory_limit = read_task_yaml(cfg.task_yaml_path).get("memory_limit")
+        if memory_limit is not None:
+            logger.debug(f"Memory limit from {cfg.task_yaml_path}: {memory_limit} MiB")
+            return float(memory_limit)
+    return None
+
+
+def _resolve_time_normalization(cfg: ReporterConfig, pool: SandboxPool) -> Optional[TimeNormalization]:
+    """Host calibration (measured in a box of pool the first time) and judge calibration of the report"""
+    if not cfg.calibrate and cfg.judge_calibration is None:
+        return None
+    with pool.sandbox() as sandbox:
+        host = calibrate(cfg.cache_dir, sandbox=sandbox)
+    judge = load_calibration(cfg.judge_calibration) if cfg.judge_calibration is not None else None
+    if judge is not None:
+        logger.info(f"Judge {judge.host} is {host.score / judge.score:.2f}x as fast as {host.host}")
+    return TimeNormalization(host, judge)
+
+
+def _resolve_run_cache(cfg: ReporterConfig) -> Optional[RunCache]:
+    return RunCache(cfg.cache_dir) if cfg.incremental else None
+
+
 def _compile_checker(cfg: ReporterConfig) -> Optional[str]:
     if cfg.checker_path is None:
         return None
@@ -104,95 +476,186 @@ def _compile_checker(cfg: ReporterConfig) -> Optional[str]:
         logger.error(f"Checker file not found: {cfg.checker_path}")
         return None
 
-    os.makedirs(cfg.cache_dir, exist_ok=True)
-
-    hash_ctx = hashlib.md5()
-    hash_ctx.update(cfg.checker_path.encode())
-    hash_ctx.update(str(os.path.getmtime(cfg.checker_path)).encode())
-    hash_ctx.update(cfg.testlib_path.encode())
-    hash_ctx.update(str(os.path.getmtime(cfg.testlib_path)).encode())
-    checker_hash = hash_ctx.hexdigest()
-    checker_exe_path = os.path.join(cfg.cache_dir, f"checker_{checker_hash}")
-
-    if os.path.exists(checker_exe_path):
-        logger.debug(f"Using cached checker: {checker_exe_path}")
-        return checker_exe_path
+    with open(cfg.checker_path, "r") as f:
+        checker_code = f.read()
+    with open(cfg.testlib_path, "r") as f:
+        testlib_h = f.read()
 
-    compile_dir = tempfile.mkdtemp(dir=cfg.cache_dir, prefix="checker-src-")
-    checker_src_path = os.path.join(compile_dir, "checker.cpp")
-    testlib_copy_path = os.path.join(compile_dir, "testlib.h")
-
-    with open(cfg.checker_path, "r") as f_in, open(checker_src_path, "w") as f_out:
-        f_out.write(f_in.read())
-
-    with open(cfg.testlib_path, "r") as f_in, open(testlib_copy_path, "w") as f_out:
-        f_out.write(f_in.read())
-
-    compile_cmd = [
-        "g++",
-        "-std=c++17",
-        "-O2",
-        checker_src_path,
-        "-o",
-        checker_exe_path,
-    ]
-    logger.debug(f"Compiling checker with command: {' '.join(compile_cmd)}")
     try:
-        subprocess.run(compile_cmd, check=True, cwd=compile_dir)
-        logger.debug(f"Checker compiled successfully: {checker_exe_path}")
+        checker_files = {"testlib.h": testlib_h, **prepare_extra_files(cfg.checker_extra_files)}
+        checker_exe_path = compile_cpp(checker_code, checker_files, cache_dir=cfg.cache_dir)
+        logger.debug(f"Checker compiled: {checker_exe_path}")
         return checker_exe_path
-    except subprocess.CalledProcessError as exc:
+    except RuntimeError as exc:
         logger.error(f"Failed to compile checker: {exc}")
         return None
-    finally:
-        shutil.rmtree(compile_dir, ignore_errors=True)
 
 
-def _run_test(test_file: str, sol_code: str, lang: str, checker_executable: Optional[str]) -> TestCaseResult:
+def _run_test(test_file: str, sol_code: str, lang: str, checker: Optional[CheckerServer],
+              sandbox: Optional[Sandbox] = None, time_limit: float = 1.0,
+              run_cache: Optional[RunCache] = None, memory_limit: Optional[float] = None,
+              sample_memory: bool = False) -> TestCaseResult:
+    """Run and judge one test, memory_limit in MiB (None for isolate's default limit)"""
     logger.debug(f"Processing test file: {test_file}")
+    with trace.span("report.run_test", "report", test=_test_name(test_file)) as test_span:
+        if run_cache is not None:
+            result = _run_test_cached(test_file, sol_code, lang, checker, sandbox, time_limit, run_cache,
+                                      memory_limit, sample_memory)
+        else:
+            with tempfile.TemporaryDirectory(prefix="pygenlib-out-") as out_dir:
+                participant_path = os.path.join(out_dir, "output.txt")
+                result = _run_test_to(test_file, participant_path, sol_code, lang, checker, sandbox, time_limit,
+                                      memory_limit, sample_memory)
+        test_span["verdict"] = result.verdict
+        return result
+
+
+def _run_outdated(record: RunRecord, time_limit: float, memory_limit: Optional[float] = None,
+                  sample_memory: bool = False) -> bool:
+    """Whether a cached run has to be run again for these limits
+
+    The limits change the run itself (the program is killed), samples are only taken on request.
+    Check with `python3 -m doctest pygenlib/report.py`:
+
+    >>> record = RunRecord(run={"time_limit": 1.5, "memory_limit_kib": 262144}, output_path="")
+    >>> _run_outdated(record, 1.0, 256)
+    False
+    >>> _run_outdated(record, 2.0, 256)
+    True
+    >>> _run_outdated(record, 1.0, 512)
+    True
+    >>> _run_outdated(record, 1.0, 256, sample_memory=True)
+    True
+    >>> _run_outdated(RunRecord(run={}, output_path=""), 1.0, 256)
+    True
+    """
+    return (record.run.get("memory_limit_kib") != _memory_limit_kib(memory_limit)
+            or record.run.get("time_limit") != _kill_time_limit(time_limit)
+            or sample_memory and record.run.get("memory_samples") is None)
+
+
+def _kill_time_limit(time_limit: float) -> float:
+    """CPU time isolate kills a solution at, above the time limit so a run just over it is still measured as TLE"""
+    return time_limit + _TIME_LIMIT_MARGIN
+
+
+# Seconds of CPU time a solution may run past the time limit before it is killed
+_TIME_LIMIT_MARGIN = 0.5
+
+
+def _run_test_to(test_file: str, participant_path: str, sol_code: str, lang: str,
+                 checker: Optional[CheckerServer], sandbox: Optional[Sandbox], time_limit: float,
+                 memory_limit: Optional[float] = None, sample_memory: bool = False) -> TestCaseResult:
+    run_result = _run_solution(test_file, participant_path, sol_code, lang, sandbox, time_limit, memory_limit,
+                               sample_memory)
+    answer_file = test_file.replace(".i", ".o")
+    return _judge(test_file, run_result, time_limit,
+                  lambda: _check_output(checker, test_file, participant_path, answer_file))
+
+
+def _run_test_cached(test_file: str, sol_code: str, lang: str, checker: Optional[CheckerServer],
+                     sandbox: Optional[Sandbox], time_limit: float, run_cache: RunCache,
+                     memory_limit: Optional[float] = None, sample_memory: bool = False) -> TestCaseResult:
+    """Like _run_test_to(), but the run and the checker verdict come from run_cache when they are still valid"""
+    sol_id = run_cache.solution_id(sol_code, lang)
+    input_sha = run_cache.file_sha256(test_file)
+    record = run_cache.get(sol_id, input_sha)
+    if record is not None and _run_outdated(record, time_limit, memory_limit, sample_memory):
+        record = None
+    trace.cache("run", hit=record is not None)
+    if record is None:
+        participant_path = run_cache.new_output_path(sol_id, input_sha)
+        try:
+            run_result = _run_solution(test_file, participant_path, sol_code, lang, sandbox,
+                                       time_limit, memory_limit, sample_memory)
+            record = run_cache.put(sol_id, input_sha, run_result, participant_path)
+        finally:
+            if os.path.exists(participant_path):
+                os.remove(participant_path)
+    else:
+        logger.debug(f"Run of {test_file} taken from cache: {record.output_path}")
+
+    answer_file = test_file.replace(".i", ".o")
+
+    def check() -> CheckerVerdict:
+        key = {
+            "checker": _checker_id(checker),
+            "answer": run_cache.file_sha256(answer_file),
+        }
+        cached = record.check is not None and all(record.check.get(k) == v for k, v in key.items())
+        trace.cache("checker verdict", hit=cached)
+        if cached:
+            logger.debug(f"Checker verdict for {test_file} taken from cache")
+            return CheckerVerdict(**record.check["verdict"])
+        checker_verdict = _check_output(checker, test_file, record.output_path, answer_file)
+        # A checker failure may be transient (timeout, crash), it is checked again next time
+        if checker_verdict.verdict != "FAIL":
+            run_cache.put_check(sol_id, input_sha, record, {**key, "verdict": asdict(checker_verdict)})
+        return checker_verdict
+
+    return _judge(test_file, record.isolate_result(), time_limit, check)
 
-    with open(test_file, "r") as f:
-        stdin = f.read()
-        logger.debug(f"Read input file, size: {len(stdin)} bytes")
 
+def _memory_limit_kib(memory_limit: Optional[float]) -> Optional[int]:
+    return int(memory_limit * 1024) if memory_limit is not None else None
+
+
+def _run_solution(test_file: str, participant_path: str, sol_code: str, lang: str,
+                  sandbox: Optional[Sandbox], time_limit: float, memory_limit: Optional[float] = None,
+                  sample_memory: bool = False) -> IsolateResult:
     logger.debug(f"Running solution in {lang} language")
     if lang == "cpp":
-        run_result = run_cpp_code(sol_code, stdin=stdin)
+        run = run_cpp_code
     elif lang == "py":
-        run_result = run_py_code(sol_code, stdin=stdin)
+        run = run_py_code
     else:
         logger.error(f"Unsupported language: {lang}")
         raise ValueError(f"Unsupported language: {lang}")
+    limits = {"time_limit": _kill_time_limit(time_limit), "memory_limit_kib": _memory_limit_kib(memory_limit),
+              "sample_memory": sample_memory}
+    if is_compressed(test_file):
+        # Decompressed on the fly into the solution's stdin
+        stdin_fd = open_stdin(test_file)
+        try:
+            run_result = run(sol_code, stdin="", sandbox=sandbox, stdin_fd=stdin_fd, stdout_path=participant_path,
+                             **limits)
+        finally:
+            os.close(stdin_fd)
+    else:
+        run_result = run(sol_code, stdin="", sandbox=sandbox, stdin_path=test_file, stdout_path=participant_path,
+                         **limits)
 
-    if run_result.status not in ["OK", "TO", "SG"]:
-        logger.error(f"Execution failed with status: {run_result.status}")
-        print(run_result)
-        exit()
+    # RE (non-zero exit code), SG (signal) and TO are verdicts, XX is an isolate failure
+    if run_result.status not in ["OK", "TO", "SG", "RE"]:
+        logger.error(f"Execution of {test_file} failed with status {run_result.status}: {run_result.stderr}")
+        raise RuntimeError(f"isolate failed with status {run_result.status} on {test_file}: "
+                           f"{run_result.stderr.strip()}")
+    return run_result
 
-    test_name = os.path.basename(test_file).split(".i")[1]
-    logger.debug(f"Test name: {test_name}, execution status: {run_result.status}")
 
-    answer_file = test_file.replace(".i", ".o")
-    logger.debug(f"Reading answer from: {answer_file}")
-    with open(answer_file, "r") as f:
-        answer = f.read()
+def _judge(test_file: str, run_result: IsolateResult, time_limit: float,
+           check: Callable[[], "CheckerVerdict"]) -> TestCaseResult:
+    """Verdict of a finished run, check() is only called for runs within the limits"""
+    test_name = _test_name(test_file)
+    logger.debug(f"Test name: {test_name}, execution status: {run_result.status}")
 
     verdict = "AC"
     checker_msg = "-"
+    checker_verdict = CheckerVerdict(verdict, checker_msg)
 
-    if run_result.status == "SG":
+    memory_limit_kib = run_result.memory_limit_kib
+    if run_result.oom_killed or (memory_limit_kib is not None and run_result.cg_mem_kib > memory_limit_kib):
+        logger.warning(f"Memory limit exceeded on test {test_name}: {run_result.cg_mem_kib/1024:.2f}MiB")
+        verdict = "MLE"
+    elif run_result.status in ["SG", "RE"]:
         logger.warning(f"Runtime error on test {test_name}")
         verdict = "RE"
-    elif run_result.status == "TO" or run_result.exec_time > 1:
+    elif run_result.status == "TO" or run_result.exec_time > time_limit:
         logger.warning(f"Time limit exceeded on test {test_name}: {run_result.exec_time}s")
         verdict = "TLE"
     else:
-        if checker_executable:
-            logger.debug("Using checker to verify output")
-            verdict, checker_msg = _run_checker(checker_executable, test_file, run_result.stdout, answer)
-        else:
-            logger.debug("Using string comparison to verify output")
-            verdict = _string_compare(run_result.stdout, answer)
+        checker_verdict = check()
+        verdict, checker_msg = checker_verdict.verdict, checker_verdict.message
 
     logger.debug(
         f"Test {test_name} result: {verdict}, time: {run_result.exec_time:.2f}s, "
@@ -205,70 +668,281 @@ def _run_test(test_file: str, sol_code: str, lang: str, checker_executable: Opti
         mem_mib=run_result.cg_mem_kib / 1024,
         test_name=test_name,
         checker_msg=checker_msg,
+        checker_points=checker_verdict.points,
+        checker_time=checker_verdict.time,
+        checker_mem_mib=checker_verdict.mem_kib / 1024,
+        wall_time=run_result.wall_time,
+        max_rss_mib=run_result.max_rss_kib / 1024,
+        memory_samples=run_result.memory_samples,
+        alloc_time=_allocation_time(run_result.memory_samples),
     )
 
 
-def _run_checker(checker_executable: str, input_file: str, participant_output: str, jury_output: str) -> Tuple[str, str]:
-    with tempfile.NamedTemporaryFile(mode="w", delete=False) as participant_file:
-        participant_file.write(participant_output)
-        participant_path = participant_file.name
+def _allocation_time(samples: Optional[list]) -> Optional[float]:
+    """Seconds until the sampled memory use first reached 90% of its peak, None without samples"""
+    if not samples:
+        return None
+    peak = max(kib for _, kib in samples)
+    return next(t for t, kib in samples if kib >= 0.9 * peak)
+
 
-    with tempfile.NamedTemporaryFile(mode="w", delete=False) as jury_file:
-        jury_file.write(jury_output)
-        jury_path = jury_file.name
+def _checker_id(checker: Optional[CheckerServer]) -> str:
+    """What verdicts are computed by, for the run cache"""
+    if checker is None:
+        return "string-compare"
+    checker_id = os.path.basename(checker.checker_executable)
+    return f"{checker_id}+compare" if checker.compare_first else checker_id
 
+
+def _check_output(checker: Optional[CheckerServer], test_file: str, participant_path: str,
+                  answer_file: str) -> "CheckerVerdict":
+    if checker and not checker.compare_first:
+        logger.debug("Using checker to verify output")
+        return _run_checker(checker, test_file, participant_path, answer_file)
+    if _outputs_match(participant_path, answer_file):
+        logger.debug(f"Output matches {answer_file}")
+        return CheckerVerdict("AC", "Output matches the answer" if checker else "-")
+    if checker:
+        logger.debug("Output differs from the answer, using checker to verify it")
+        return _run_checker(checker, test_file, participant_path, answer_file)
+    logger.warning("Wrong answer detected via string comparison")
+    return CheckerVerdict("WA", "-")
+
+
+@dataclass
+class CheckerVerdict:
+    """Checker result for one output, as reported by testlib's JSON verdict"""
+
+    verdict: str  # "AC", "WA", "PC" or "FAIL"
+    message: str
+    points: Optional[float] = None
+    time: float = 0.0  # Checker CPU time in seconds
+    mem_kib: int = 0  # Checker peak RSS in KiB
+
+
+# testlib verdict names mapped to report verdicts, PE and unexpected EOF are wrong answers
+_CHECKER_VERDICTS = {
+    "OK": "AC",
+    "WA": "WA",
+    "PE": "WA",
+    "UNEXPECTED_EOF": "WA",
+    "POINTS": "PC",
+    "PARTIALLY": "PC",
+    "FAIL": "FAIL",
+}
+
+
+def _run_checker(checker: CheckerServer, input_file: str, participant_path: str, jury_path: str) -> CheckerVerdict:
+    """Run the testlib checker on files, the outputs are passed by path and not copied"""
     try:
-        checker_cmd = [checker_executable, input_file, participant_path, jury_path]
-        logger.debug(f"Running checker: {' '.join(checker_cmd)}")
-        proc = subprocess.run(
-            checker_cmd,
-            capture_output=True,
-            text=True,
-            timeout=5,
-        )
-
-        if proc.returncode == 0:
-            logger.debug("Checker returned AC")
-            return "AC", proc.stdout.strip()
-        if proc.returncode == 1:
-            logger.debug(f"Checker returned WA: {proc.stdout.strip()}")
-            return "WA", proc.stdout.strip()
-
-        logger.error(f"Checker failed with return code {proc.returncode}")
-        logger.error(f"Checker stderr: {proc.stderr}")
-        return "WA", f"Checker error: {proc.stderr}"
+        logger.debug(f"Checking {participant_path} against {jury_path}")
+        with trace.span("report.checker", "report", bytes=trace.file_size(participant_path)):
+            result = checker.check(input_file, participant_path, jury_path)
     except subprocess.TimeoutExpired:
-        logger.error("Checker timed out after 5 seconds")
-        return "WA", "Checker timed out"
+        logger.error(f"Checker timed out after {checker.timeout:g} seconds")
+        return CheckerVerdict("FAIL", "Checker timed out", time=checker.timeout)
     except Exception as exc:
         logger.error(f"Error running checker: {exc}")
-        return "WA", f"Checker error: {exc}"
-    finally:
-        logger.debug("Cleaning up temporary checker files")
-        os.unlink(participant_path)
-        os.unlink(jury_path)
+        return CheckerVerdict("FAIL", f"Checker error: {exc}")
+
+    verdict = _CHECKER_VERDICTS.get(result["verdict"], "FAIL")
+    message = result["message"]
+    if verdict == "FAIL":
+        logger.error(f"Checker failed: {result['verdict']} {message}")
+        message = f"Checker error: {result['verdict']} {message}"
+    else:
+        logger.debug(f"Checker returned {verdict}: {message}")
+    points = result.get("points")
+    return CheckerVerdict(
+        verdict,
+        message,
+        points=float(points) if points is not None else None,
+        time=result.get("time", 0.0),
+        mem_kib=result.get("memory_kib", 0),
+    )
+
+
+def _outputs_match(participant_path: str, answer_file: str) -> bool:
+    """Whether the output equals the answer up to trailing whitespace of every line.
+
+    The files are compared in chunks first, a byte-identical output never gets split into lines.
+    Otherwise their lines are compared one pair at a time, without reading either file into memory.
+    """
+    with trace.span("report.compare", "report", bytes=trace.file_size(participant_path)):
+        return _compare_outputs(participant_path, answer_file)
+
+
+def _compare_outputs(participant_path: str, answer_file: str) -> bool:
+    with open(participant_path, "rb") as participant, open_plain(answer_file) as answer:
+        while True:
+            participant_chunk = participant.read(_COMPARE_CHUNK)
+            if participant_chunk != answer.read(_COMPARE_CHUNK):
+                break
+            if not participant_chunk:
+                return True
+
+    with open(participant_path, "rb") as participant, open_plain(answer_file) as answer:
+        lines = 0
+        for participant_line, answer_line in itertools.zip_longest(participant, answer):
+            lines += 1
+            participant_line = participant_line.rstrip() if participant_line is not None else None
+            answer_line = answer_line.rstrip() if answer_line is not None else None
+            if participant_line != answer_line:
+                # An empty file matches a single blank line, like "\n".join() of the trimmed lines did
+                if lines == 1 and not participant_line and not answer_line:
+                    return next(answer if participant_line is None else participant, None) is None
+                return False
+        return True
+
+
+_COMPARE_CHUNK = 1 << 20
 
 
-def _string_compare(participant_output: str, jury_output: str) -> str:
-    trim = lambda s: "\n".join(line.rstrip() for line in s.splitlines())
-    if trim(participant_output) != trim(jury_output):
-        logger.warning("Wrong answer detected via string comparison")
-        return "WA"
-    logger.debug("String comparison accepted the answer")
-    return "AC"
+def _test_name(test_file: str) -> str:
+    """Test case name without task prefix, "01a" for task.i01a"""
+    return plain_name(test_file).split(".i")[1]
 
 
-def _initialize_report_file(output_path: str, include_checker_msg: bool):
+def _test_group(test_name: str) -> str:
+    """Testgroup of a test name like "01a" (see the LIO naming in the readme)"""
+    match = re.match(r"\d+", test_name)
+    return match.group(0) if match else test_name
+
+
+def _plan_testgroups(cfg: ReporterConfig, test_files: list[str]) -> list[list[str]]:
+    """Test files grouped by testgroup in the order early abort runs them.
+
+    The cost of a test is estimated by its input size. Groups run from the cheapest to the most
+    expensive, so the points of cheap groups are known early; inside a group the largest test,
+    the one a slow solution most likely fails, runs first.
+    """
+    groups: dict[str, list[str]] = {}
+    for test_file in test_files:
+        groups.setdefault(_test_group(_test_name(test_file)), []).append(test_file)
+    sizes = {test_file: plain_size(os.path.join(cfg.tests_dir, test_file)) for test_file in test_files}
+    for group_files in groups.values():
+        group_files.sort(key=lambda test_file: sizes[test_file], reverse=True)
+    return sorted(groups.values(), key=lambda group_files: sum(sizes[test_file] for test_file in group_files))
+
+
+def _run_testgroup(test_files: list[str], run: Callable[[str], TestCaseResult]) -> dict[str, TestCaseResult]:
+    """Run the tests of one testgroup in order until one is not AC, the rest are SKIP"""
+    results = {}
+    failed: Optional[TestCaseResult] = None
+    for test_file in test_files:
+        if failed is not None:
+            results[test_file] = TestCaseResult(verdict="SKIP", exec_time=0.0, mem_mib=0.0,
+                                                test_name=_test_name(test_file),
+                                                checker_msg=f"{failed.test_name} is {failed.verdict}")
+            continue
+        results[test_file] = result = run(test_file)
+        if result.verdict != "AC":
+            failed = result
+            if len(test_files) > 1:
+                logger.info(f"Test {result.test_name} is {result.verdict}, skipping the rest of its testgroup")
+    return results
+
+
+def _write_score(report_path: str, results: list[TestCaseResult], cfg: ReporterConfig) -> float:
+    """Write the LIO score of one solution's report to {report}_score.tsv, returns the total.
+
+    A testgroup of cfg.task_yaml_path's tests_groups gives its points when all its tests are AC.
+    Each subtask row has the points of its passed testgroups out of subtask_points
+    (or out of the points of all its testgroups when subtask_points has no entry for it).
+    """
+    if cfg.task_yaml_path is None:
+        raise ValueError("scoring a report requires ReporterConfig.task_yaml_path")
+    task = read_task_yaml(cfg.task_yaml_path)
+    testgroups = read_testgroups(task)
+    subtask_points = task.get("subtask_points") or []
+
+    passed: dict[int, bool] = {}
+    for result in results:
+        group = _test_group(result.test_name)
+        if not group.isdigit() or int(group) not in testgroups:
+            logger.warning(f"Test {result.test_name} is not in a testgroup of {cfg.task_yaml_path}")
+            continue
+        passed[int(group)] = passed.get(int(group), True) and result.verdict == "AC"
+
+    base_path = os.path.splitext(report_path)[0]
+    total = total_max = 0.0
+    with open(f"{base_path}_score.tsv", "w", newline="") as f:
+        writer = csv.writer(f, delimiter="\t")
+        writer.writerow(["subtask", "groups", "[points]", "[max]"])
+        for subtask in sorted({entry["subtask"] for entry in testgroups.values()}):
+            groups = sorted(tg for tg, entry in testgroups.items() if entry["subtask"] == subtask)
+            missing = [tg for tg in groups if tg not in passed]
+            if missing:
+                logger.warning(f"Testgroups {missing} of subtask {subtask} have no tests, they get no points")
+            points = sum(testgroups[tg]["points"] for tg in groups if passed.get(tg))
+            groups_max = sum(testgroups[tg]["points"] for tg in groups)
+            subtask_max = subtask_points[subtask] if subtask < len(subtask_points) else groups_max
+            if subtask_max != groups_max:
+                logger.warning(f"Subtask {subtask} is worth {subtask_max} points in subtask_points, "
+                               f"its testgroups {groups_max}")
+            writer.writerow([subtask, f"{sum(1 for tg in groups if passed.get(tg))}/{len(groups)}",
+                             f"{points:g}", f"{subtask_max:g}"])
+            total += points
+            total_max += subtask_max
+        writer.writerow(["total", "", f"{total:g}", f"{total_max:g}"])
+    logger.info(f"Score of {os.path.basename(base_path)}: {total:g}/{total_max:g}, written to {base_path}_score.tsv")
+    return total
+
+
+def _write_memory_profile(report_path: str, results: list[TestCaseResult], memory_limit: Optional[float]):
+    """Write the memory peaks of one solution's report per testgroup.
+
+    {report}_memory.tsv has per testgroup the test with the highest cgroup peak, the peak in MiB and
+    in percent of the memory limit, and the longest allocation phase (time until 90% of the peak).
+    {report}_memory.json has the sampled memory curve of every test.
+    """
+    base_path = os.path.splitext(report_path)[0]
+    groups: dict[str, list[TestCaseResult]] = {}
+    for result in results:
+        groups.setdefault(_test_group(result.test_name), []).append(result)
+
+    with open(f"{base_path}_memory.tsv", "w", newline="") as f:
+        writer = csv.writer(f, delimiter="\t")
+        writer.writerow(["group", "tests", "peak test", "[peak mib]", "[limit %]", "[alloc sec]", "res"])
+        for group in sorted(groups):
+            group_results = groups[group]
+            peak = max(group_results, key=lambda r: r.mem_mib)
+            alloc_times = [r.alloc_time for r in group_results if r.alloc_time is not None]
+            writer.writerow([
+                group + " ",
+                len(group_results),
+                peak.test_name + " ",
+                f"{peak.mem_mib:.2f}",
+                f"{100 * peak.mem_mib / memory_limit:.1f}" if memory_limit else "-",
+                f"{max(alloc_times):.3f}" if alloc_times else "-",
+                "/".join(sorted({r.verdict for r in group_results})),
+            ])
+    with open(f"{base_path}_memory.json", "w") as f:
+        json.dump({
+            "memory_limit_mib": memory_limit,
+            "tests": {r.test_name: {"peak_mib": r.mem_mib, "alloc_time": r.alloc_time, "samples": r.memory_samples}
+                      for r in results},
+        }, f)
+    logger.info(f"Memory profile written to {base_path}_memory.tsv and {base_path}_memory.json")
+
+
+def _initialize_report_file(output_path: str, include_checker_msg: bool, timing: Optional[TimeNormalization] = None):
     with open(output_path, "w", newline="") as f:
         writer = csv.writer(f, delimiter="\t")
+        header = ["test", "res", "[sec]", "[mib]"]
+        if timing is not None:
+            header.append("[norm]")
+            if timing.judge is not None:
+                header += ["[judge sec]", "[tl margin]"]
         if include_checker_msg:
-            writer.writerow(["test", "res", "[sec]", "[mib]", "msg"])
-        else:
-            writer.writerow(["test", "res", "[sec]", "[mib]"])
+            # After msg, so the columns of the baseline layout keep their place
+            header += ["msg", "[chk sec]", "[chk mib]"]
+        writer.writerow(header)
     logger.debug(f"Created report file: {output_path}")
 
 
-def _append_result(output_path: str, result: TestCaseResult, include_checker_msg: bool):
+def _append_result(output_path: str, result: TestCaseResult, include_checker_msg: bool,
+                   timing: Optional[TimeNormalization] = None, time_limit: Optional[float] = None):
     with open(output_path, "a", newline="") as f:
         writer = csv.writer(f, delimiter="\t")
         row = [
@@ -277,11 +951,20 @@ def _append_result(output_path: str, result: TestCaseResult, include_checker_msg
             f"{result.exec_time:.2f}",
             f"{result.mem_mib:.2f}",
         ]
+        if timing is not None:
+            row.append(f"{timing.normalized(result.exec_time):.2f}")
+            judge_time = timing.judge_time(result.exec_time)
+            if judge_time is not None:
+                row.append(f"{judge_time:.2f}")
+                # Share of the time limit left on the judge, negative when the test would be TLE there
+                row.append(f"{1 - judge_time / time_limit:+.0%}" if time_limit else "-")
         if include_checker_msg:
-            if result.checker_msg:
-                row.append(result.checker_msg[:100])
-            else:
-                row.append("-")
+            message = " ".join(result.checker_msg.split())
+            if result.checker_points is not None:
+                message = f"[{result.checker_points:g} pts] {message}"
+            row.append(message[:100] or "-")
+            row.append(f"{result.checker_time:.2f}")
+            row.append(f"{result.checker_mem_mib:.2f}")
         writer.writerow(row)
     logger.debug(
         f"Test {result.test_name}: {result.verdict}, "
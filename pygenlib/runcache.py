@@ -0,0 +1,112 @@
+from dataclasses import asdict, dataclass
+from typing import Optional
+import hashlib
+import json
+import logging
+import os
+import tempfile
+import threading
+
+from pygenlib.build import compile_cpp
+from pygenlib.isolate import IsolateResult
+
+logger = logging.getLogger(__name__)
+
+# Raw solution outputs use their own extension, clean() removes every *.out file
+_OUTPUT_EXT = ".stdout"
+
+
+@dataclass
+class RunRecord:
+    """Cached run of one solution executable on one input"""
+
+    run: dict  # IsolateResult fields without stdout/stderr
+    output_path: str  # Raw output of the run inside the cache
+    check: Optional[dict] = None  # {"checker": id, "answer": sha256, "verdict": CheckerVerdict fields}
+
+    def isolate_result(self) -> IsolateResult:
+        return IsolateResult(stdout="", stderr="", stdout_path=self.output_path, **self.run)
+
+
+class RunCache:
+    """Solution runs and checker verdicts cached in {cache_dir}/runs.
+
+    A run is keyed by (solution executable hash, input hash) and keeps the raw output and the
+    isolate metadata, the checker verdict is kept next to it with the checker and answer
+    hashes it was computed for. A report then only runs missing pairs and only re-checks
+    outputs whose checker or answer changed.
+    """
+
+    def __init__(self, cache_dir: str):
+        self.runs_dir = os.path.join(cache_dir, "runs")
+        os.makedirs(self.runs_dir, exist_ok=True)
+        self._hashes: dict[tuple, str] = {}
+        self._lock = threading.Lock()
+
+    def solution_id(self, sol_code: str, lang: str) -> str:
+        """Hash of the executable the solution runs as: the build cache key for C++, the source for Python"""
+        if lang == "cpp":
+            return os.path.basename(compile_cpp(sol_code))
+        return hashlib.sha256(f"{lang}\0{sol_code}".encode()).hexdigest()
+
+    def file_sha256(self, path: str) -> str:
+        """sha256 of a file, remembered by (path, size, mtime) for the lifetime of the cache object"""
+        st = os.stat(path)
+        key = (os.path.abspath(path), st.st_size, st.st_mtime_ns)
+        with self._lock:
+            digest = self._hashes.get(key)
+        if digest is None:
+            m = hashlib.sha256()
+            with open(path, "rb") as f:
+                for chunk in iter(lambda: f.read(1 << 20), b""):
+                    m.update(chunk)
+            digest = m.hexdigest()
+            with self._lock:
+                self._hashes[key] = digest
+        return digest
+
+    def get(self, sol_id: str, input_sha: str) -> Optional[RunRecord]:
+        record_path = self._record_path(sol_id, input_sha)
+        try:
+            with open(record_path) as f:
+                record = RunRecord(**json.load(f))
+        except (OSError, ValueError, TypeError):
+            return None
+        if not os.path.exists(record.output_path):
+            return None
+        return record
+
+    def new_output_path(self, sol_id: str, input_sha: str) -> str:
+        """Temporary file in the cache directory for a run's output, pass it to put()"""
+        os.makedirs(os.path.join(self.runs_dir, sol_id), exist_ok=True)
+        fd, tmp_path = tempfile.mkstemp(dir=os.path.join(self.runs_dir, sol_id), prefix=f".tmp-{input_sha[:12]}-")
+        os.close(fd)
+        return tmp_path
+
+    def put(self, sol_id: str, input_sha: str, run_result: IsolateResult, tmp_output_path: str) -> RunRecord:
+        """Move the output of a finished run into the cache and record its metadata"""
+        output_path = os.path.join(self.runs_dir, sol_id, input_sha + _OUTPUT_EXT)
+        os.replace(tmp_output_path, output_path)
+        run = {k: v for k, v in asdict(run_result).items() if k not in ("stdout", "stderr", "stdout_path")}
+        record = RunRecord(run=run, output_path=output_path)
+        self._write_record(sol_id, input_sha, record)
+        return record
+
+    def put_check(self, sol_id: str, input_sha: str, record: RunRecord, check: dict):
+        record.check = check
+        self._write_record(sol_id, input_sha, record)
+
+    def _record_path(self, sol_id: str, input_sha: str) -> str:
+        return os.path.join(self.runs_dir, sol_id, input_sha + ".json")
+
+    def _write_record(self, sol_id: str, input_sha: str, record: RunRecord):
+        # Write, then rename, so an interrupted report never leaves a partial record
+        record_path = self._record_path(sol_id, input_sha)
+        fd, tmp_path = tempfile.mkstemp(dir=os.path.dirname(record_path), prefix=".tmp-")
+        try:
+            with os.fdopen(fd, "w") as f:
+                json.dump(asdict(record), f)
+            os.replace(tmp_path, record_path)
+        except BaseException:
+            os.remove(tmp_path)
+            raise
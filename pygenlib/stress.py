@@ -0,0 +1,345 @@
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass
+from typing import Callable, Iterable, Optional
+import logging
+import math
+import os
+import random
+import shlex
+import shutil
+import signal
+import tempfile
+import threading
+import time
+
+from pygenlib.build import compile_cpp, prepare_extra_files
+from pygenlib.isolate import IsolateResult, Sandbox, SandboxPool, run_cmd_in_isolate
+from pygenlib.report import (CheckerServer, ReporterConfig, _check_output, _compile_checker, _detect_language,
+                             _read_solution, _resolve_reporter_config)
+from pygenlib.testgen import GeneratorConfig, _resolve_generator_config
+
+logger = logging.getLogger(__name__)
+
+# Files of an iteration inside the box, the stage file names the program running when the chain stopped.
+# Every input gets a new name: checker --server keeps parsed inputs by path, size and mtime in seconds.
+_INPUT = "input-{}.txt"
+_ANSWER = "answer.txt"
+_OUTPUT = "output.txt"
+_STAGE = ".stage"
+# Exit status of the failed program, the candidate's stderr and its CPU time ("user system" from bash's time)
+_EXIT = ".exit"
+_CANDIDATE_ERR = ".candidate_err"
+_CANDIDATE_TIME = ".candidate_time"
+# Exit status of a program stopped at its soft ulimit -t CPU limit
+_CPU_LIMIT_STATUS = 128 + signal.SIGXCPU
+
+
+@dataclass
+class StressFailure:
+    """Input on which the candidate disagrees with the model solution"""
+
+    n: int  # Size the arguments were made for
+    args: list[str]  # Generator arguments, the last one is the seed label
+    verdict: str  # Checker verdict ("WA", "PC") or "RE"/"TLE" of the candidate
+    message: str  # Checker message
+    input_path: str
+    answer_path: str  # Model solution's output
+    output_path: str  # Candidate's output
+
+
+@dataclass
+class StressResult:
+    candidate: str
+    iterations: int  # Iterations run, the minimization included
+    elapsed: float  # Seconds
+    iterations_per_second: float
+    failure: Optional[StressFailure] = None  # Smallest failing input found, None if the candidate survived
+
+
+def stress(candidate_path: str, make_args: Callable[[int, random.Random], list], sizes: Iterable[int],
+           cfg: Optional[GeneratorConfig] = None, reporter_cfg: Optional[ReporterConfig] = None,
+           max_iterations: int = 10000, time_budget: Optional[float] = None, shrink_tries: int = 200,
+           seed: int = 0, time_limit: float = 2.0, helper_time_limit: float = 10.0, workers: Optional[int] = None,
+           box_ids: Optional[Iterable[int]] = None, pool: Optional[SandboxPool] = None) -> StressResult:
+    """Search for an input on which a candidate solution disagrees with the model solution.
+
+    Every iteration picks a size n from sizes and calls make_args(n, rng) for the rest of the
+    generator arguments (tree type, frequency ranges, ...). A seed label is appended, which
+    changes testlib's generator seed. Generator, model solution and candidate are compiled once
+    and copied into every box once, then an iteration is a single isolate run that chains the three
+    programs, each with its own CPU limit (ulimit -t). The checker is the report's (checker --server),
+    or string comparison without one. An iteration whose generator or model solution runs out of
+    helper_time_limit is skipped with a warning.
+
+    Iterations are spread over the boxes until one fails. Then the input is minimized: every
+    smaller size is tried, smallest first, with up to shrink_tries seeds each. The smallest failing
+    input, the model's answer and the candidate's output are written to
+    {reports_dir}/{task_name}_stress_{candidate}/, along with the generator arguments.
+
+    Args:
+        candidate_path: Solution under test, C++ or Python.
+        make_args: Generator arguments for size n, drawn from the given random generator.
+        sizes: Values of n to sweep.
+        cfg: Generator and model solution, resolved like in gen() when omitted.
+        reporter_cfg: Checker and reports_dir, resolved like in report() when omitted.
+        max_iterations: Iterations of the search, the minimization not included.
+        time_budget: Seconds after which the search stops even without a failure.
+        shrink_tries: Seeds tried for each smaller size during minimization.
+        seed: Base of the seeds, the same seed repeats the same inputs.
+        time_limit: CPU seconds of the candidate, a candidate running longer is TLE.
+        helper_time_limit: CPU seconds of the generator and of the model solution.
+        workers, box_ids, pool: Isolate boxes to run in, like in GenScheduler.
+    """
+    cfg = _resolve_generator_config(cfg)
+    reporter_cfg = _resolve_reporter_config(reporter_cfg)
+    sizes = sorted(set(sizes))
+    if not sizes:
+        raise ValueError("stress() requires at least one size")
+    candidate_name = os.path.splitext(os.path.basename(candidate_path))[0]
+
+    runner = _StressRunner(cfg, reporter_cfg, candidate_path, time_limit, helper_time_limit)
+    own_pool = pool is None
+    if own_pool:
+        if box_ids is None:
+            box_ids = range(workers or os.cpu_count() or 1)
+        pool = SandboxPool(box_ids)
+    sandboxes = pool.acquire_many(len(pool) if workers is None else min(workers, len(pool)))
+    logger.info(f"Stress testing {candidate_path} against {cfg.model_solution_path} "
+                f"on n in [{sizes[0]}, {sizes[-1]}] using {len(sandboxes)} isolate boxes")
+
+    start = time.monotonic()
+    deadline = start + time_budget if time_budget is not None else None
+    iterations = 0
+    failure = None
+    try:
+        with ThreadPoolExecutor(max_workers=len(sandboxes)) as executor:
+            list(executor.map(runner.stage, sandboxes))
+            iterations, failure = _search(runner, make_args, sizes, f"s{seed}-", max_iterations, deadline,
+                                          sandboxes, executor)
+            if failure is not None:
+                logger.info(f"{candidate_name} is {failure.verdict} on n={failure.n}, args {failure.args}; "
+                            f"minimizing")
+                for n in sizes:
+                    if n >= failure.n:
+                        break
+                    tried, smaller = _search(runner, make_args, [n], f"s{seed}-n{n}-", shrink_tries, None,
+                                             sandboxes, executor)
+                    iterations += tried
+                    if smaller is not None:
+                        _remove_failure(failure)
+                        failure = smaller
+                        break
+    finally:
+        for sandbox in sandboxes:
+            pool.release(sandbox)
+        if own_pool:
+            pool.close()
+        runner.close()
+
+    elapsed = time.monotonic() - start
+    result = StressResult(candidate_name, iterations, elapsed, iterations / elapsed if elapsed > 0 else 0.0)
+    if failure is not None:
+        result.failure = _save_failure(failure, os.path.join(reporter_cfg.reports_dir,
+                                                             f"{reporter_cfg.task_name}_stress_{candidate_name}"))
+        logger.warning(f"{candidate_name} is {failure.verdict} on n={failure.n}, generator args {failure.args}, "
+                       f"saved to {os.path.dirname(result.failure.input_path)}")
+    else:
+        logger.info(f"{candidate_name} survived {iterations} iterations")
+    logger.info(f"{iterations} iterations in {elapsed:.1f}s, {result.iterations_per_second:.1f} iterations/s")
+    return result
+
+
+def _search(runner: "_StressRunner", make_args, sizes: list[int], label: str, max_iterations: int,
+            deadline: Optional[float], sandboxes: list[Sandbox],
+            executor: ThreadPoolExecutor) -> tuple[int, Optional[StressFailure]]:
+    """Run iterations in all boxes until one fails, returns (iterations run, first failure)"""
+    lock = threading.Lock()
+    stop = threading.Event()
+    state = {"next": 0, "done": 0, "failure": None}
+
+    def work(sandbox: Sandbox):
+        while not stop.is_set():
+            with lock:
+                i = state["next"]
+                if i >= max_iterations or (deadline is not None and time.monotonic() > deadline):
+                    return
+                state["next"] += 1
+            rng = random.Random(f"{label}{i}")
+            n = rng.choice(sizes)
+            args = [str(arg) for arg in make_args(n, rng)] + [f"{label}{i}"]
+            failure = runner.run(sandbox, n, args)
+            with lock:
+                state["done"] += 1
+                if failure is not None:
+                    if state["failure"] is None:
+                        state["failure"] = failure
+                    else:
+                        _remove_failure(failure)
+                    stop.set()
+
+    futures = [executor.submit(work, sandbox) for sandbox in sandboxes]
+    try:
+        for future in futures:
+            future.result()
+    finally:
+        stop.set()
+    return state["done"], state["failure"]
+
+
+class _StressRunner:
+    """Executables of one stress run, staged into each box once"""
+
+    def __init__(self, cfg: GeneratorConfig, reporter_cfg: ReporterConfig, candidate_path: str, time_limit: float,
+                 helper_time_limit: float):
+        self.time_limit = time_limit
+        # ulimit -t takes whole seconds, a candidate is killed after time_limit and judged by its measured CPU time
+        self.candidate_cpu_limit = math.ceil(time_limit) + 1
+        self.helper_cpu_limit = math.ceil(helper_time_limit)
+        with open(cfg.testlib_header_path, "r") as f:
+            testlib_h = f.read()
+        self.run_files = prepare_extra_files(cfg.gen_extra_files)
+        # The same compiler inputs as run_cpp_code() in gen(), so the builds come from the build cache
+        with open(cfg.generator_path, "r") as f:
+            self.gen_exe = compile_cpp(f.read(), {"testlib.h": testlib_h, **self.run_files})
+        with open(cfg.model_solution_path, "r") as f:
+            self.model_exe = compile_cpp(f.read())
+        self.candidate_lang = _detect_language(candidate_path)
+        if self.candidate_lang == "cpp":
+            self.candidate_exe = compile_cpp(_read_solution(candidate_path))
+            self.candidate_cmd = "./candidate"
+        else:
+            self.candidate_exe = candidate_path
+            self.candidate_cmd = "python3 candidate.py"
+        checker_executable = _compile_checker(reporter_cfg) if reporter_cfg.checker_path else None
+        self.checker = (CheckerServer(checker_executable, compare_first=reporter_cfg.compare_outputs)
+                        if checker_executable else None)
+
+    def stage(self, sandbox: Sandbox):
+        sandbox.wipe()
+        box_dir = os.path.join(sandbox.box_path, "box")
+        shutil.copy2(self.gen_exe, os.path.join(box_dir, "gen"))
+        shutil.copy2(self.model_exe, os.path.join(box_dir, "model"))
+        shutil.copy2(self.candidate_exe, os.path.join(box_dir, "candidate" if self.candidate_lang == "cpp"
+                                                      else "candidate.py"))
+        for filename, content in self.run_files.items():
+            with open(os.path.join(box_dir, filename), "w") as f:
+                f.write(content)
+
+    def run(self, sandbox: Sandbox, n: int, args: list[str]) -> Optional[StressFailure]:
+        """One iteration in a staged box, returns the failure with copies of its files, None if it passed"""
+        box_dir = os.path.join(sandbox.box_path, "box")
+        input_name = _INPUT.format(args[-1])
+        gen_args = " ".join(shlex.quote(arg) for arg in args)
+        steps = [
+            ("generator", f"({_ulimit_cpu(self.helper_cpu_limit)} && exec ./gen {gen_args}) > {input_name}"),
+            ("model", f"({_ulimit_cpu(self.helper_cpu_limit)} && exec ./model) < {input_name} > {_ANSWER}"),
+            ("candidate", f"({_ulimit_cpu(self.candidate_cpu_limit)} && TIMEFORMAT='%3U %3S' && "
+                          f"time {self.candidate_cmd} < {input_name} > {_OUTPUT} 2> {_CANDIDATE_ERR})"
+                          f" 2> {_CANDIDATE_TIME}"),
+        ]
+        # Every step stops the chain with its own exit status, the stage file names the step that failed
+        script = f"rm -f {_EXIT} {_CANDIDATE_TIME}; " + "".join(
+            f"echo {stage} > {_STAGE} && {command} || {{ echo $? > {_EXIT}; exit 1; }}; " for stage, command in steps
+        ) + f"echo done > {_STAGE}"
+        # A limit for the whole chain too, against programs that sleep instead of using CPU
+        chain_limit = 2 * self.helper_cpu_limit + self.candidate_cpu_limit + 1
+        try:
+            result = run_cmd_in_isolate(script, None, "", box_path=sandbox.box_path, time_limit=chain_limit,
+                                        box_id=sandbox.box_id, cleanup=False, cpu=sandbox.cpu)
+            return self._judge(box_dir, input_name, n, args, result)
+        finally:
+            if os.path.exists(os.path.join(box_dir, input_name)):
+                os.remove(os.path.join(box_dir, input_name))
+
+    def _judge(self, box_dir: str, input_name: str, n: int, args: list[str],
+               result: IsolateResult) -> Optional[StressFailure]:
+        try:
+            with open(os.path.join(box_dir, _STAGE)) as f:
+                stage = f.read().strip()
+        except OSError:
+            stage = "generator"
+        exit_status = _read_number(os.path.join(box_dir, _EXIT))
+        timed_out = result.status == "TO" or exit_status == _CPU_LIMIT_STATUS
+        if stage in ("generator", "model"):
+            if timed_out:
+                logger.warning(f"Stress {stage} ran out of time on generator args {args}, iteration skipped")
+                return None
+            raise RuntimeError(f"Stress {stage} failed with status {result.status} on generator args {args}: "
+                               f"{result.stderr.strip()}")
+
+        paths = [os.path.join(box_dir, name) for name in (input_name, _ANSWER, _OUTPUT)]
+        candidate_time = _read_cpu_time(os.path.join(box_dir, _CANDIDATE_TIME))
+        if timed_out or (candidate_time is not None and candidate_time > self.time_limit):
+            verdict, message = "TLE", f"{candidate_time:.2f}s" if candidate_time is not None else ""
+        elif stage == "candidate":
+            verdict, message = "RE", _read_text(os.path.join(box_dir, _CANDIDATE_ERR)).strip()
+        else:
+            checker_verdict = _check_output(self.checker, paths[0], paths[2], paths[1])
+            if checker_verdict.verdict == "AC":
+                return None
+            if checker_verdict.verdict == "FAIL":
+                # The model's answer or the generated input is wrong, not the candidate
+                raise RuntimeError(f"Checker failed on generator args {args}: {checker_verdict.message}")
+            verdict, message = checker_verdict.verdict, checker_verdict.message
+
+        # The box is reused by the next iteration, keep copies of the failing files
+        failure_dir = tempfile.mkdtemp(prefix="pygenlib-stress-")
+        copies = []
+        for path, name in zip(paths, ("input.txt", _ANSWER, _OUTPUT)):
+            copy_path = os.path.join(failure_dir, name)
+            if os.path.exists(path):
+                shutil.copyfile(path, copy_path)
+            else:
+                open(copy_path, "w").close()
+            copies.append(copy_path)
+        return StressFailure(n, args, verdict, message, *copies)
+
+    def close(self):
+        if self.checker is not None:
+            self.checker.close()
+
+
+def _ulimit_cpu(seconds: int) -> str:
+    """Shell command limiting the CPU time of the subshell, SIGXCPU at seconds and SIGKILL a second later"""
+    return f"ulimit -S -t {seconds} && ulimit -H -t {seconds + 1}"
+
+
+def _read_text(path: str) -> str:
+    try:
+        with open(path) as f:
+            return f.read()
+    except OSError:
+        return ""
+
+
+def _read_number(path: str) -> Optional[int]:
+    text = _read_text(path).strip()
+    return int(text) if text.isdigit() else None
+
+
+def _read_cpu_time(path: str) -> Optional[float]:
+    """CPU seconds from bash's time output, its last line (a killed program's message comes first)"""
+    lines = _read_text(path).split("\n")
+    try:
+        user, system = [line for line in lines if line.strip()][-1].split()
+        return float(user) + float(system)
+    except (IndexError, ValueError):
+        return None
+
+
+def _remove_failure(failure: StressFailure):
+    shutil.rmtree(os.path.dirname(failure.input_path), ignore_errors=True)
+
+
+def _save_failure(failure: StressFailure, output_dir: str) -> StressFailure:
+    os.makedirs(output_dir, exist_ok=True)
+    saved = []
+    for path in (failure.input_path, failure.answer_path, failure.output_path):
+        saved_path = os.path.join(output_dir, os.path.basename(path))
+        shutil.move(path, saved_path)
+        saved.append(saved_path)
+    _remove_failure(failure)
+    with open(os.path.join(output_dir, "args.txt"), "w") as f:
+        f.write(" ".join(shlex.quote(arg) for arg in failure.args) + "\n")
+        f.write(f"{failure.verdict} {failure.message}\n")
+    return StressFailure(failure.n, failure.args, failure.verdict, failure.message, *saved)
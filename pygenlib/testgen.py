@@ -1,11 +1,23 @@
-from dataclasses import dataclass
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, field
+import hashlib
 import json
-from typing import Mapping, Optional
+from typing import Iterable, Mapping, Optional
 
-from pygenlib import config
-from pygenlib.isolate import run_cpp_code
+from pygenlib import config, trace
+from pygenlib.build import compile_cpp, prepare_extra_files
+from pygenlib.isolate import Sandbox, SandboxPool, run_cpp_code
+from pygenlib.testpack import GZ_EXT, BlobSink, BlobWriter, PlainCopies, compress_file, open_stdin
+from pygenlib.report import (CheckerServer, ReporterConfig, TestCaseResult, _compile_checker, _detect_language,
+                             _read_solution, _resolve_memory_limit, _resolve_reporter_config, _resolve_run_cache,
+                             _resolve_time_limit, _run_test, _test_group)
+import fcntl
 import logging
 import os
+import re
+import shutil
+import subprocess
+import tempfile
 
 logger = logging.getLogger(__name__)
 
@@ -18,6 +30,10 @@ class GeneratorConfig:
     testlib_header_path: str
     tests_dir: str
     gen_extra_files: dict[str, str]
+    cache_dir: Optional[str] = None  # Test data cache goes to {cache_dir}/testdata, defaults to config cache dir
+    validator_path: Optional[str] = None  # testlib validator run on every generated input, None to skip validation
+    compress_tests: bool = False  # Store tests as gzip blobs ({task_name}.i01a.gz), see testpack
+    validator_extra_files: dict[str, str] = field(default_factory=dict)  # Validator headers, like gen_extra_files
 
 _default_generator_config: Optional[GeneratorConfig] = None
 
@@ -26,15 +42,25 @@ def override_generator_config(cfg: GeneratorConfig):
     global _default_generator_config
     _default_generator_config = cfg
 
-def gen(tg_ext, *args, cfg: Optional[GeneratorConfig] = None, extra_files: Optional[Mapping[str, str]] = None):
+def gen(tg_ext, *args, cfg: Optional[GeneratorConfig] = None, extra_files: Optional[Mapping[str, str]] = None,
+        pool: Optional[SandboxPool] = None, group: Optional[str] = None):
     """Generate input and expected output (answer) for a test case.
 
     1. Adds testlib.h and gen.cpp to the isolate sandbox.
-    2. Runs gen.cpp with the given args to generate the input.
-    3. Saves the input to {tests_dir}/{task_name}.i{tg_ext}
-    4. Adds model solution to a new isolate sandbox.
-    5. Runs the model solution on the input to generate the expected output.
-    6. Saves the expected output to {tests_dir}/{task_name}.o{tg_ext}
+    2. Runs gen.cpp with the given args, its stdout is saved to {tests_dir}/{task_name}.i{tg_ext}
+    3. Adds model solution to a new isolate sandbox.
+    4. Runs the model solution with the input file as stdin, its stdout is saved
+       to {tests_dir}/{task_name}.o{tg_ext}
+       Meanwhile the validator (if configured) checks the same input with --group {group}.
+       A rejected test is removed and an exception is raised.
+
+    Test data goes through files only (isolate --stdin/--stdout), never through Python strings.
+    With cfg.compress_tests both files are gzip blobs ({task_name}.i{tg_ext}.gz), compressed as the
+    programs write them and decompressed on the fly into the stdin of the model solution and the validator.
+
+    Both files are cached by content: the input by hash(generator source, testlib.h, extra files, args, tg_ext)
+    and the answer by hash(model solution source, input). A cached file is copied instead of running the program,
+    so only tests whose inputs changed are regenerated.
 
     Args:
         tg_ext: Suffix for the test case (e.g. "00a", "00b")
@@ -44,57 +70,442 @@ def gen(tg_ext, *args, cfg: Optional[GeneratorConfig] = None, extra_files: Optio
         extra_files: Optional mapping of filename -> file path or literal contents.
             Files are added alongside testlib.h inside the generator sandbox.
             These are merged with files added via config.add_gen_file() (this parameter takes precedence).
+        pool: Optional SandboxPool to take the isolate box from, instead of initializing one per run.
+        group: Validator group of the test, available as validator.group() in validator.cpp.
     """
     cfg = _resolve_generator_config(cfg)
     os.makedirs(cfg.tests_dir, exist_ok=True)
+    if pool is None:
+        _gen_test(cfg, tg_ext, args, extra_files, group=group)
+    else:
+        with pool.sandbox() as sandbox:
+            _gen_test(cfg, tg_ext, args, extra_files, sandbox=sandbox, group=group)
+
+
+def _gen_test(cfg: GeneratorConfig, tg_ext, args, extra_files: Optional[Mapping[str, str]] = None,
+              sandbox: Optional[Sandbox] = None, group: Optional[str] = None,
+              model_sandbox: Optional[Sandbox] = None):
+    """Generate one test, see gen().
 
-    logger.debug(f"Generating test {tg_ext} with args: {args}")
-    args = [str(arg) for arg in args]
-    args.append(tg_ext)
+    With a model_sandbox the stages overlap (see _gen_streamed()): the generator's stdout is
+    piped into the model solution and the validator while it is written to the input file.
+    """
+    with trace.span("testgen.gen", "testgen", test=tg_ext) as gen_span:
+        logger.debug(f"Generating test {tg_ext} with args: {args}")
+        args = _generator_args(tg_ext, args)
+        gen_code, testlib_h, compile_files, run_files = _generator_files(cfg, extra_files)
+
+        ext = GZ_EXT if cfg.compress_tests else ""
+        input_path = os.path.join(cfg.tests_dir, f"{cfg.task_name}.i{tg_ext}{ext}")
+        output_path = os.path.join(cfg.tests_dir, f"{cfg.task_name}.o{tg_ext}{ext}")
+        # A test stored the other way by an earlier run would be listed twice by the reports
+        stale_ext = "" if cfg.compress_tests else GZ_EXT
+        _remove_files(*(os.path.join(cfg.tests_dir, f"{cfg.task_name}.{kind}{tg_ext}{stale_ext}") for kind in "io"))
+        cache_dir = _testdata_dir(cfg)
+        cached_input = _input_cache_path(cache_dir, gen_code, testlib_h, run_files, args, ext)
 
+        restored = _restore_cached(cached_input, input_path)
+        trace.cache("test input", hit=restored)
+        if restored:
+            logger.debug(f"Input for test {tg_ext} taken from cache: {cached_input}")
+        elif model_sandbox is not None:
+            _gen_streamed(cfg, tg_ext, args, gen_code, compile_files, run_files, testlib_h, input_path, output_path,
+                          cached_input, cache_dir, sandbox, model_sandbox, group)
+            gen_span["bytes"] = trace.file_size(input_path) + trace.file_size(output_path)
+            return
+        elif cfg.compress_tests:
+            with BlobSink(input_path) as sink:
+                gen_res = run_cpp_code(
+                    gen_code, "", args=args, extra_compile_files=compile_files, extra_run_files=run_files,
+                    sandbox=sandbox, stdout_fd=sink.fd
+                )
+            if gen_res.exit_code != 0:
+                os.remove(input_path)
+                _raise_generator_failed(cfg, tg_ext, args, gen_res)
+            _store_cached(input_path, cached_input)
+        else:
+            gen_res = run_cpp_code(
+                gen_code, "", args=args, extra_compile_files=compile_files, extra_run_files=run_files, sandbox=sandbox,
+                stdout_path=input_path
+            )
+            if gen_res.exit_code != 0:
+                os.remove(input_path)
+                _raise_generator_failed(cfg, tg_ext, args, gen_res)
+            _store_cached(input_path, cached_input)
+
+        validator_proc = _start_validator(cfg, testlib_h, input_path, group)
+        try:
+            _gen_answer(cfg, tg_ext, args, input_path, output_path, cache_dir, model_sandbox or sandbox)
+        except BaseException:
+            if validator_proc is not None:
+                validator_proc.kill()
+                validator_proc.wait()
+            raise
+        if validator_proc is not None:
+            _, validator_err = validator_proc.communicate()
+            if validator_proc.returncode != 0:
+                os.remove(input_path)
+                os.remove(output_path)
+                _raise_validator_rejected(cfg, tg_ext, args, group, validator_err)
+        gen_span["bytes"] = trace.file_size(input_path) + trace.file_size(output_path)
+
+
+def _generator_args(tg_ext, args) -> list[str]:
+    """Command line arguments of the generator for a test, the test suffix is the last one"""
+    return [str(arg) for arg in args] + [tg_ext]
+
+
+def _generator_files(cfg: GeneratorConfig, extra_files: Optional[Mapping[str, str]]):
+    """(generator source, testlib.h, compile files, run files) of a gen() call"""
+    with open(cfg.generator_path, "r") as f:
+        gen_code = f.read()
     with open(cfg.testlib_header_path, "r") as f:
         testlib_h = f.read()
 
     compile_files = {"testlib.h": testlib_h}
     # Merge stored extra files with passed extra files (passed ones take precedence)
     merged_extra_files = {**cfg.gen_extra_files, **(extra_files or {})}
-    run_files = _prepare_extra_files(merged_extra_files)
+    run_files = prepare_extra_files(merged_extra_files)
     compile_files.update(run_files)
+    return gen_code, testlib_h, compile_files, run_files
 
-    with open(cfg.generator_path, "r") as f:
+
+def _testdata_dir(cfg: GeneratorConfig) -> str:
+    cache_dir = os.path.join(cfg.cache_dir or config.get_cache_dir_path(), "testdata")
+    os.makedirs(cache_dir, exist_ok=True)
+    return cache_dir
+
+
+def _input_cache_path(cache_dir: str, gen_code: str, testlib_h: str, run_files: dict[str, str],
+                      args: list[str], ext: str) -> str:
+    m = hashlib.sha256()
+    for part in [gen_code, testlib_h, *(f"{name}\0{run_files[name]}" for name in sorted(run_files)), *args]:
+        m.update(part.encode())
+        m.update(b"\0")
+    return os.path.join(cache_dir, f"{m.hexdigest()}.i{ext}")
+
+
+_MULTIGEN_MANIFEST = "multigen.txt"
+
+
+def _multigen_inputs(cfg: GeneratorConfig, jobs: list["GenJob"], sandbox: Sandbox):
+    """Generate the uncached inputs of jobs into the input cache with one generator run (gen --multigen).
+
+    All jobs must have the same extra files. The generator forks a process per test that is seeded
+    from the test's own arguments, so the inputs and their cache keys are the same as from separate runs;
+    _gen_test() then takes them from the cache.
+    """
+    gen_code, testlib_h, compile_files, run_files = _generator_files(cfg, jobs[0].extra_files)
+    ext = GZ_EXT if cfg.compress_tests else ""
+    cache_dir = _testdata_dir(cfg)
+
+    pending = []
+    for job in jobs:
+        args = _generator_args(job.tg_ext, job.args)
+        if any("\t" in arg or "\n" in arg for arg in args):
+            raise ValueError(f"multigen arguments of test {job.tg_ext} can't contain tabs or newlines: {args}")
+        cached_input = _input_cache_path(cache_dir, gen_code, testlib_h, run_files, args, ext)
+        if not os.path.exists(cached_input):
+            pending.append((job, args, cached_input))
+    if not pending:
+        return
+
+    logger.debug(f"Generating tests {', '.join(job.tg_ext for job, _, _ in pending)} in one generator run")
+    manifest = "".join(f"{i}.in\t" + "\t".join(args) + "\n" for i, (_, args, _) in enumerate(pending))
+    # The tests' arguments are written into the generator's argv, so it needs as many entries as the longest has
+    padding = ["-"] * max(len(args) for _, args, _ in pending)
+    with trace.span("testgen.multigen", "testgen", tests=len(pending)):
         gen_res = run_cpp_code(
-            f.read(), "", args=args, extra_compile_files=compile_files, extra_run_files=run_files
+            gen_code, "", time_limit=5.0 * len(pending), args=["--multigen", _MULTIGEN_MANIFEST, *padding],
+            extra_compile_files=compile_files, extra_run_files={**run_files, _MULTIGEN_MANIFEST: manifest},
+            sandbox=sandbox
         )
+    statuses = dict(line.split("\t", 1) for line in gen_res.stdout.splitlines() if "\t" in line)
+
+    box_dir = os.path.join(sandbox.box_path, "box")
+    failed = []
+    for i, (job, args, cached_input) in enumerate(pending):
+        status = statuses.get(f"{i}.in", "not run")
+        if status != "0":
+            failed.append((job, args, status))
+            continue
+        box_file = os.path.join(box_dir, f"{i}.in")
+        if cfg.compress_tests:
+            compress_file(box_file, box_file + GZ_EXT)
+            box_file += GZ_EXT
+        _store_cached(box_file, cached_input)
+    if failed:
+        job, args, status = failed[0]
+        _raise_generator_failed(cfg, job.tg_ext, args, gen_res, status)
+
+
+def _gen_streamed(cfg: GeneratorConfig, tg_ext, args, gen_code: str, compile_files: dict[str, str],
+                  run_files: dict[str, str], testlib_h: str, input_path: str, output_path: str, cached_input: str,
+                  cache_dir: str, sandbox: Optional[Sandbox], model_sandbox: Sandbox, group: Optional[str]):
+    """Run generator, model solution and validator at the same time, connected by pipes.
+
+    A tee thread copies the generator's stdout to the input file, the input cache entry, the model
+    solution's stdin and the validator's stdin, hashing it on the way for the answer cache key.
+    The input is never read back from disk. With cfg.compress_tests the input is compressed as it
+    streams and the cache entry is a copy of the blob.
+    """
+    with open(cfg.model_solution_path, "r") as f:
+        model_sol_code = f.read()
+    validator_cmd = _validator_command(cfg, testlib_h, group)
+
+    if cfg.compress_tests:
+        cache_tmp = None
+        input_files = [lambda: BlobWriter(input_path)]
+    else:
+        fd, cache_tmp = tempfile.mkstemp(dir=cache_dir, prefix=".tmp-")
+        os.close(fd)
+        input_files = [lambda: open(input_path, "wb"), lambda: open(cache_tmp, "wb")]
+    input_hash = hashlib.sha256()
+    gen_r, gen_w = _pipe()
+    model_r, model_w = _pipe()
+    sink_fds = [model_w]
+    validator_proc = None
+    try:
+        if validator_cmd is not None:
+            validator_r, validator_w = _pipe()
+            sink_fds.append(validator_w)
+            logger.debug(f"Running validator: {' '.join(validator_cmd)} < generator of test {tg_ext}")
+            try:
+                validator_proc = subprocess.Popen(validator_cmd, stdin=validator_r, stdout=subprocess.DEVNULL,
+                                                  stderr=subprocess.PIPE, text=True)
+            except BaseException:
+                for fd in [gen_r, gen_w, model_r, *sink_fds]:
+                    os.close(fd)
+                raise
+            finally:
+                os.close(validator_r)
+
+        def run_model():
+            try:
+                if cfg.compress_tests:
+                    with BlobSink(output_path) as sink:
+                        return run_cpp_code(model_sol_code, stdin="", sandbox=model_sandbox,
+                                            stdin_fd=model_r, stdout_fd=sink.fd)
+                return run_cpp_code(model_sol_code, stdin="", sandbox=model_sandbox,
+                                    stdin_fd=model_r, stdout_path=output_path)
+            finally:
+                # The tee gets EPIPE instead of blocking once the model solution stopped reading
+                os.close(model_r)
+
+        with ThreadPoolExecutor(max_workers=2) as stages:
+            tee_future = stages.submit(_tee, gen_r, input_files, sink_fds, input_hash)
+            model_future = stages.submit(run_model)
+            try:
+                gen_res = run_cpp_code(
+                    gen_code, "", args=args, extra_compile_files=compile_files, extra_run_files=run_files,
+                    sandbox=sandbox, stdout_fd=gen_w
+                )
+            finally:
+                os.close(gen_w)
+            tee_future.result()
+            prog_res = model_future.result()
+
+        validator_err = validator_proc.communicate()[1] if validator_proc is not None else ""
         if gen_res.exit_code != 0:
-            logger.error(
-                f"Generator {cfg.generator_path} returned exit code {gen_res.exit_code} "
-                f"for test {tg_ext} with args {args}"
-            )
-            logger.error(f"Generator data: {json.dumps(gen_res.__dict__, indent=4)}")
-            raise Exception(
-                f"Generator {cfg.generator_path} returned exit code {gen_res.exit_code} "
-                f"for test {tg_ext} with args {args}"
-            )
-        input_path = os.path.join(cfg.tests_dir, f"{cfg.task_name}.i{tg_ext}")
-        with open(input_path, "w") as f_out:
-            f_out.write(gen_res.stdout)
+            _remove_files(input_path, output_path)
+            _raise_generator_failed(cfg, tg_ext, args, gen_res)
+        if prog_res.exit_code != 0:
+            _remove_files(output_path)
+            _raise_model_failed(cfg, tg_ext, args, prog_res)
+        if validator_proc is not None and validator_proc.returncode != 0:
+            _remove_files(input_path, output_path)
+            _raise_validator_rejected(cfg, tg_ext, args, group, validator_err)
+
+        if cfg.compress_tests:
+            # Answers of compressed tests are keyed by the blob, like in _gen_answer()
+            _store_cached(input_path, cached_input)
+            input_sha = _file_sha256(input_path)
+        else:
+            os.replace(cache_tmp, cached_input)
+            input_sha = input_hash.hexdigest()
+        ext = GZ_EXT if cfg.compress_tests else ""
+        _store_cached(output_path, _answer_cache_path(cache_dir, model_sol_code, input_sha, ext))
+    finally:
+        if validator_proc is not None and validator_proc.poll() is None:
+            validator_proc.kill()
+            validator_proc.wait()
+        if cache_tmp is not None:
+            _remove_files(cache_tmp)
+
+
+_TEE_CHUNK = 1 << 20  # Bytes copied per read, also the pipe buffer size _pipe() asks for
+
+
+def _pipe() -> tuple[int, int]:
+    """os.pipe() with a larger buffer where the OS allows it, so one slow reader stalls the tee less often"""
+    read_fd, write_fd = os.pipe()
+    set_pipe_size = getattr(fcntl, "F_SETPIPE_SZ", None)
+    if set_pipe_size is not None:
+        try:
+            fcntl.fcntl(write_fd, set_pipe_size, _TEE_CHUNK)
+        except OSError:
+            pass
+    return read_fd, write_fd
+
+
+def _tee(src_fd: int, openers: list, sink_fds: list[int], digest):
+    """Copy src_fd to the files returned by openers and the pipes sink_fds until EOF, then close all of them.
+
+    A pipe whose reader exited (e.g. a model solution that stops reading early) is dropped,
+    the other outputs still get the whole stream.
+    """
+    files = []
+    try:
+        for opener in openers:
+            files.append(opener())
+        while True:
+            chunk = os.read(src_fd, _TEE_CHUNK)
+            if not chunk:
+                break
+            digest.update(chunk)
+            for f in files:
+                f.write(chunk)
+            for fd in list(sink_fds):
+                try:
+                    _write_all(fd, chunk)
+                except BrokenPipeError:
+                    sink_fds.remove(fd)
+                    os.close(fd)
+    finally:
+        for f in files:
+            f.close()
+        for fd in sink_fds:
+            os.close(fd)
+        # Closing the read end makes a generator still writing get EPIPE if the tee failed
+        os.close(src_fd)
+
+
+def _write_all(fd: int, data: bytes):
+    view = memoryview(data)
+    while view:
+        view = view[os.write(fd, view):]
+
+
+def _remove_files(*paths: str):
+    for path in paths:
+        if os.path.exists(path):
+            os.remove(path)
+
+
+def _raise_generator_failed(cfg: GeneratorConfig, tg_ext, args, gen_res, status: Optional[str] = None):
+    """status is the multigen status of the test, the exit code of gen_res otherwise"""
+    result = f"exit code {gen_res.exit_code}" if status is None else f"status {status}"
+    logger.error(f"Generator {cfg.generator_path} returned {result} for test {tg_ext} with args {args}")
+    logger.error(f"Generator data: {json.dumps(gen_res.__dict__, indent=4)}")
+    raise Exception(f"Generator {cfg.generator_path} returned {result} for test {tg_ext} with args {args}")
+
+
+def _raise_model_failed(cfg: GeneratorConfig, tg_ext, args, prog_res):
+    logger.error(
+        f"Model solution {cfg.model_solution_path} returned exit code {prog_res.exit_code} "
+        f"for test {tg_ext} with args {args}"
+    )
+    logger.error(f"Model solution data: {json.dumps(prog_res.__dict__, indent=4)}")
+    raise Exception(
+        f"Model solution {cfg.model_solution_path} returned exit code {prog_res.exit_code} "
+        f"for test {tg_ext} with args {args}"
+    )
 
+
+def _raise_validator_rejected(cfg: GeneratorConfig, tg_ext, args, group: Optional[str], validator_err: str):
+    logger.error(f"Validator {cfg.validator_path} rejected test {tg_ext} with args {args}: {validator_err}")
+    raise Exception(
+        f"Validator {cfg.validator_path} rejected test {tg_ext} (group {group}): {validator_err.strip()}"
+    )
+
+
+def _validator_command(cfg: GeneratorConfig, testlib_h: str, group: Optional[str]) -> Optional[list[str]]:
+    """Compile the validator and return its command line, None if no validator is configured"""
+    if not cfg.validator_path:
+        return None
+    with open(cfg.validator_path, "r") as f:
+        validator_files = {"testlib.h": testlib_h, **prepare_extra_files(cfg.validator_extra_files)}
+        validator_exe = compile_cpp(f.read(), validator_files, cache_dir=cfg.cache_dir)
+    return [validator_exe] + (["--group", str(group)] if group is not None else [])
+
+
+def _start_validator(cfg: GeneratorConfig, testlib_h: str, input_path: str,
+                     group: Optional[str]) -> Optional[subprocess.Popen]:
+    """Start the validator on input_path in the background, None if no validator is configured"""
+    validator_cmd = _validator_command(cfg, testlib_h, group)
+    if validator_cmd is None:
+        return None
+    logger.debug(f"Running validator: {' '.join(validator_cmd)} < {input_path}")
+    stdin_fd = open_stdin(input_path)
+    try:
+        return subprocess.Popen(validator_cmd, stdin=stdin_fd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    finally:
+        os.close(stdin_fd)
+
+
+def _gen_answer(cfg: GeneratorConfig, tg_ext, args, input_path: str, output_path: str, cache_dir: str,
+                sandbox: Optional[Sandbox]):
     with open(cfg.model_solution_path, "r") as f:
         model_sol_code = f.read()
-        prog_res = run_cpp_code(model_sol_code, stdin=gen_res.stdout)
+
+    ext = GZ_EXT if cfg.compress_tests else ""
+    cached_output = _answer_cache_path(cache_dir, model_sol_code, _file_sha256(input_path), ext)
+
+    restored = _restore_cached(cached_output, output_path)
+    trace.cache("test answer", hit=restored)
+    if restored:
+        logger.debug(f"Answer for test {tg_ext} taken from cache: {cached_output}")
+    else:
+        if cfg.compress_tests:
+            stdin_fd = open_stdin(input_path)
+            try:
+                with BlobSink(output_path) as sink:
+                    prog_res = run_cpp_code(model_sol_code, stdin="", sandbox=sandbox,
+                                            stdin_fd=stdin_fd, stdout_fd=sink.fd)
+            finally:
+                os.close(stdin_fd)
+        else:
+            prog_res = run_cpp_code(model_sol_code, stdin="", sandbox=sandbox,
+                                    stdin_path=input_path, stdout_path=output_path)
         if prog_res.exit_code != 0:
-            logger.error(
-                f"Model solution {cfg.model_solution_path} returned exit code {prog_res.exit_code} "
-                f"for test {tg_ext} with args {args}"
-            )
-            logger.error(f"Model solution data: {json.dumps(prog_res.__dict__, indent=4)}")
-            raise Exception(
-                f"Model solution {cfg.model_solution_path} returned exit code {prog_res.exit_code} "
-                f"for test {tg_ext} with args {args}"
-            )
-        output_path = os.path.join(cfg.tests_dir, f"{cfg.task_name}.o{tg_ext}")
-        with open(output_path, "w") as f_out:
-            f_out.write(prog_res.stdout)
+            os.remove(output_path)
+            _raise_model_failed(cfg, tg_ext, args, prog_res)
+        _store_cached(output_path, cached_output)
+
+
+def _answer_cache_path(cache_dir: str, model_sol_code: str, input_sha256: str, ext: str = "") -> str:
+    m = hashlib.sha256(model_sol_code.encode())
+    m.update(b"\0")
+    m.update(input_sha256.encode())
+    return os.path.join(cache_dir, f"{m.hexdigest()}.o{ext}")
+
+
+def _file_sha256(path: str) -> str:
+    m = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(1 << 20), b""):
+            m.update(chunk)
+    return m.hexdigest()
+
+
+def _restore_cached(cached_path: str, dst_path: str) -> bool:
+    """Copy a cached test file to dst_path, return False if it isn't cached"""
+    if not os.path.exists(cached_path):
+        return False
+    shutil.copyfile(cached_path, dst_path)
+    return True
+
+
+def _store_cached(src_path: str, cached_path: str):
+    # Copy, then rename, so a concurrent or interrupted run never sees a partial entry
+    fd, tmp_path = tempfile.mkstemp(dir=os.path.dirname(cached_path), prefix=".tmp-")
+    os.close(fd)
+    try:
+        shutil.copyfile(src_path, tmp_path)
+        os.replace(tmp_path, cached_path)
+    except BaseException:
+        os.remove(tmp_path)
+        raise
 
 
 def _resolve_generator_config(generator_config: Optional[GeneratorConfig]) -> GeneratorConfig:
@@ -109,18 +520,267 @@ def _resolve_generator_config(generator_config: Optional[GeneratorConfig]) -> Ge
         testlib_header_path=config.get_testlib_header_path(),
         tests_dir=config.get_tests_dir_path(),
         gen_extra_files=config.get_gen_extra_files(),
+        validator_path=config.get_testlib_validator_path(),
     )
 
 
-def _prepare_extra_files(extra_files: Optional[Mapping[str, str]]) -> dict[str, str]:
-    """Return mapping of filename->contents for extra files."""
-    prepared: dict[str, str] = {}
-    if not extra_files:
-        return prepared
-    for filename, src in extra_files.items():
-        if os.path.isfile(src):
-            with open(src, "r") as f:
-                prepared[filename] = f.read()
+@dataclass
+class GroupCoverage:
+    """Bounds and features the valid tests of one validator group hit, see validate_tests()"""
+
+    valid: int  # Number of valid tests
+    invalid: int  # Number of rejected tests
+    bounds: dict[str, tuple[int, int]]  # Variable -> (tests reading its minimum, tests reading its maximum)
+    features: dict[str, int]  # Feature -> tests that hit it
+
+
+def validate_tests(tests: Iterable[tuple[str, Optional[str]]], cfg: Optional[GeneratorConfig] = None,
+                   coverage_path: Optional[str] = None) -> tuple[dict[str, str], dict[str, GroupCoverage]]:
+    """Validate existing test files in one validator process (testlib "validator --batch").
+
+    The validator is registered once, each file is then validated by a process forked from it,
+    so the parsed command line, the streams and the static arrays of validator.cpp are set up once.
+    Compressed tests are decompressed into a temporary copy first.
+
+    Args:
+        tests: (input file, validator group) pairs, group None for no --group.
+        cfg: Generator configuration with the validator, resolved like in gen() when omitted.
+        coverage_path: File the validator writes its coverage table to, one block per group:
+            how many valid tests read the minimum and maximum of each variable and hit each feature.
+
+    Returns ({input file: rejection message}, {group: GroupCoverage}), valid files have no message.
+    """
+    cfg = _resolve_generator_config(cfg)
+    with open(cfg.testlib_header_path, "r") as f:
+        testlib_h = f.read()
+    validator_cmd = _validator_command(cfg, testlib_h, None)
+    if validator_cmd is None:
+        raise ValueError("validate_tests() requires a validator (GeneratorConfig.validator_path)")
+    tests = list(tests)
+
+    with tempfile.TemporaryDirectory(prefix="pygenlib-validate-") as tmp_dir:
+        summary_path = coverage_path or os.path.join(tmp_dir, "coverage.txt")
+        validator_cmd += ["--batch", "--testOverviewLogFileName", os.path.abspath(summary_path)]
+        logger.info(f"Validating {len(tests)} tests: {' '.join(validator_cmd)}")
+        rejected: dict[str, str] = {}
+        copies = PlainCopies(capacity=1)
+        proc = subprocess.Popen(validator_cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True)
+        try:
+            for input_path, group in tests:
+                with copies.plain(input_path) as plain_path:
+                    proc.stdin.write(f"{os.path.abspath(plain_path)}\t{'' if group is None else group}\n")
+                    proc.stdin.flush()
+                    reply = proc.stdout.readline()
+                if not reply:
+                    raise Exception(f"Validator {cfg.validator_path} exited during batch validation")
+                verdict = json.loads(reply)
+                if verdict["verdict"] != "OK":
+                    rejected[input_path] = verdict["message"]
+                    logger.error(f"Validator {cfg.validator_path} rejected {input_path} (group {group}): "
+                                 f"{verdict['message']}")
+            proc.stdin.close()
+            if proc.wait() != 0:
+                raise Exception(f"Validator {cfg.validator_path} failed to write the coverage to {summary_path}")
+        finally:
+            if proc.poll() is None:
+                proc.kill()
+                proc.wait()
+            copies.close()
+
+        with open(summary_path, "r") as f:
+            coverage = _parse_coverage(f.read())
+    if coverage_path:
+        logger.info(f"Validator coverage written to {coverage_path}")
+    return rejected, coverage
+
+
+_COVERAGE_GROUP_RE = re.compile(r'group "(.*)": (\d+) valid, (\d+) invalid')
+_COVERAGE_BOUNDS_RE = re.compile(r'"(.*)": min-value-hit (\d+)/\d+ max-value-hit (\d+)/\d+')
+_COVERAGE_FEATURE_RE = re.compile(r'feature "(.*)": hit (\d+)/\d+')
+
+
+def _parse_coverage(summary: str) -> dict[str, GroupCoverage]:
+    groups: dict[str, GroupCoverage] = {}
+    group = None
+    for line in summary.splitlines():
+        if match := _COVERAGE_GROUP_RE.fullmatch(line):
+            group = groups[match[1]] = GroupCoverage(int(match[2]), int(match[3]), {}, {})
+        elif group is not None and (match := _COVERAGE_BOUNDS_RE.fullmatch(line)):
+            group.bounds[match[1]] = (int(match[2]), int(match[3]))
+        elif group is not None and (match := _COVERAGE_FEATURE_RE.fullmatch(line)):
+            group.features[match[1]] = int(match[2])
+    return groups
+
+
+@dataclass
+class GenJob:
+    """A queued gen() call"""
+    tg_ext: str
+    args: tuple
+    extra_files: Optional[Mapping[str, str]] = None
+    group: Optional[str] = None
+
+
+class GenScheduler:
+    """Collects gen() calls and runs them concurrently in separate isolate boxes.
+
+    Each job still runs generator -> model solution (+ validator) in order, inside one pooled box.
+    With pipeline=True a job takes two boxes and the stages overlap instead: the generator's output
+    is piped into the model solution and the validator while it is written to the input file.
+    Jobs are independent, since every test writes only its own {task_name}.i/.o{tg_ext} files.
+    Errors are raised in the order the jobs were queued.
+
+    With multigen=True the tests of a testgroup (with the same extra files) are one job instead: a single
+    generator process writes all their uncached inputs (gen --multigen, see testlib.h), then the model
+    solution and the validator run on each test in the same box. The generator must read its arguments
+    from argv or opt() after registerGen, not from argc.
+
+    Smoke solutions are run and checked on each test as soon as its answer exists, while
+    the remaining tests are still being generated.
+
+    Usage:
+        scheduler = GenScheduler(cfg)
+        scheduler.gen("01a", 10, 1, 5, "star", "random", 1, 5)
+        ...
+        scheduler.run()
+    """
+
+    def __init__(self, cfg: Optional[GeneratorConfig] = None, workers: Optional[int] = None,
+                 box_ids: Optional[Iterable[int]] = None, pool: Optional[SandboxPool] = None,
+                 pipeline: bool = False, smoke_solutions: Optional[Iterable[str]] = None,
+                 reporter_cfg: Optional[ReporterConfig] = None, multigen: bool = False):
+        """
+        Args:
+            cfg: Generator configuration, resolved like in gen() when omitted.
+            workers: Number of tests generated at once. Defaults to the CPU count.
+            box_ids: Isolate box ids to use. Defaults to 0..workers-1, 0..2*workers-1 with pipeline.
+            pool: Existing SandboxPool to take boxes from (box_ids is ignored then).
+                Otherwise a pool is created for the duration of run().
+            pipeline: Overlap generator, model solution and validator of each test, two boxes per job.
+            smoke_solutions: Solutions run on every generated test, results are returned by run().
+            reporter_cfg: Checker and time limit for the smoke runs, resolved like in report() when omitted.
+            multigen: Generate the inputs of each testgroup in one generator run, one box per testgroup.
+        """
+        if pipeline and multigen:
+            raise ValueError("pipeline and multigen can't be combined")
+        self.cfg = cfg
+        self.multigen = multigen
+        self.pool = pool
+        self.pipeline = pipeline
+        self.smoke_solutions = list(smoke_solutions or [])
+        self.reporter_cfg = reporter_cfg
+        self.boxes_per_job = boxes_per_job = 2 if pipeline else 1
+        if pool is not None:
+            self.box_ids = list(pool.box_ids)
+        elif box_ids is not None:
+            self.box_ids = list(box_ids)
         else:
-            prepared[filename] = src
-    return prepared
\ No newline at end of file
+            self.box_ids = list(range(boxes_per_job * (workers or os.cpu_count() or 1)))
+        if len(self.box_ids) < boxes_per_job:
+            raise ValueError(f"at least {boxes_per_job} isolate box ids are required")
+        self.workers = min(workers or len(self.box_ids) // boxes_per_job, len(self.box_ids) // boxes_per_job)
+        self.jobs: list[GenJob] = []
+
+    def gen(self, tg_ext, *args, extra_files: Optional[Mapping[str, str]] = None, group: Optional[str] = None):
+        """Queue a test case, same arguments as the module-level gen()."""
+        if any(job.tg_ext == tg_ext for job in self.jobs):
+            raise ValueError(f"test {tg_ext} is already queued")
+        self.jobs.append(GenJob(tg_ext, args, extra_files, group))
+
+    def run(self) -> dict[str, list[TestCaseResult]]:
+        """Generate all queued tests and clear the queue.
+
+        Returns the smoke solution results, solution path -> one result per test in queue order.
+        """
+        cfg = _resolve_generator_config(self.cfg)
+        os.makedirs(cfg.tests_dir, exist_ok=True)
+        jobs, self.jobs = self.jobs, []
+        units = self._multigen_units(jobs) if self.multigen else [[job] for job in jobs]
+        box_ids = self.box_ids[:self.workers * self.boxes_per_job]
+        logger.info(f"Generating {len(jobs)} tests using {len(box_ids)} isolate boxes"
+                    + (", pipelined" if self.pipeline else "")
+                    + (f", {len(units)} generator runs" if self.multigen else ""))
+
+        smoke = [(sol_path, _read_solution(sol_path), _detect_language(sol_path))
+                 for sol_path in self.smoke_solutions]
+        checker = None
+        time_limit = None
+        memory_limit = None
+        run_cache = None
+        if smoke:
+            reporter_cfg = _resolve_reporter_config(self.reporter_cfg)
+            time_limit = _resolve_time_limit(reporter_cfg)
+            memory_limit = _resolve_memory_limit(reporter_cfg)
+            run_cache = _resolve_run_cache(reporter_cfg)
+            checker_executable = _compile_checker(reporter_cfg) if reporter_cfg.checker_path else None
+            checker = (CheckerServer(checker_executable, compare_first=reporter_cfg.compare_outputs)
+                       if checker_executable else None)
+
+        pool = self.pool if self.pool is not None else SandboxPool(box_ids)
+
+        def run_smoke(input_path: str, sol_code: str, lang: str) -> TestCaseResult:
+            with pool.sandbox() as sandbox:
+                return _run_test(input_path, sol_code, lang, checker, sandbox, time_limit, run_cache, memory_limit)
+
+        def submit_smoke(job: GenJob, smoke_executor: ThreadPoolExecutor) -> dict:
+            ext = GZ_EXT if cfg.compress_tests else ""
+            input_path = os.path.join(cfg.tests_dir, f"{cfg.task_name}.i{job.tg_ext}{ext}")
+            return {sol_path: smoke_executor.submit(run_smoke, input_path, sol_code, lang)
+                    for sol_path, sol_code, lang in smoke}
+
+        def run_unit(unit: list[GenJob], smoke_executor: ThreadPoolExecutor) -> list[dict]:
+            if self.pipeline:
+                job, = unit
+                with pool.sandboxes(2) as (sandbox, model_sandbox):
+                    _gen_test(cfg, job.tg_ext, job.args, job.extra_files, sandbox=sandbox, group=job.group,
+                              model_sandbox=model_sandbox)
+                return [submit_smoke(job, smoke_executor)]
+            unit_smoke = []
+            with pool.sandbox() as sandbox:
+                if self.multigen:
+                    _multigen_inputs(cfg, unit, sandbox)
+                for job in unit:
+                    _gen_test(cfg, job.tg_ext, job.args, job.extra_files, sandbox=sandbox, group=job.group)
+                    unit_smoke.append(submit_smoke(job, smoke_executor))
+            return unit_smoke
+
+        smoke_results: dict[str, list[TestCaseResult]] = {sol_path: [] for sol_path, _, _ in smoke}
+        try:
+            with ThreadPoolExecutor(max_workers=self.workers) as smoke_executor, \
+                    ThreadPoolExecutor(max_workers=self.workers) as executor:
+                futures = [executor.submit(run_unit, unit, smoke_executor) for unit in units]
+                smoke_futures = []
+                try:
+                    for future in futures:
+                        smoke_futures.extend(future.result())
+                    # Back to queue order, multigen units may have taken jobs out of it
+                    position = {job.tg_ext: i for i, job in enumerate(jobs)}
+                    unit_jobs = [job for unit in units for job in unit]
+                    for job, job_smoke in sorted(zip(unit_jobs, smoke_futures), key=lambda p: position[p[0].tg_ext]):
+                        for sol_path, smoke_future in job_smoke.items():
+                            result = smoke_future.result()
+                            if result.verdict != "AC":
+                                logger.warning(f"Smoke solution {sol_path} got {result.verdict} on test {job.tg_ext}")
+                            smoke_results[sol_path].append(result)
+                except BaseException:
+                    for future in futures:
+                        future.cancel()
+                    for job_smoke in smoke_futures:
+                        for smoke_future in job_smoke.values():
+                            smoke_future.cancel()
+                    raise
+        finally:
+            if pool is not self.pool:
+                pool.close()
+            if checker is not None:
+                checker.close()
+        return smoke_results
+
+    @staticmethod
+    def _multigen_units(jobs: list[GenJob]) -> list[list[GenJob]]:
+        """Jobs grouped by testgroup and extra files, in the order of their first job"""
+        units: dict[tuple, list[GenJob]] = {}
+        for job in jobs:
+            extra_files = tuple(sorted(job.extra_files.items())) if job.extra_files else ()
+            units.setdefault((_test_group(job.tg_ext), extra_files), []).append(job)
+        return list(units.values())
@@ -0,0 +1,310 @@
+from collections import OrderedDict
+from typing import Optional
+import contextlib
+import gzip
+import logging
+import os
+import shutil
+import struct
+import tempfile
+import threading
+import zlib
+
+logger = logging.getLogger(__name__)
+
+# Compressed tests are gzip blobs next to where the plain file would be, e.g. radiotorni.i01a.gz.
+# gzip wraps a raw deflate stream with its CRC-32 and size, which is exactly what a zip entry stores,
+# so build_archive() copies the compressed bytes into tests.zip without decompressing them.
+GZ_EXT = ".gz"
+COMPRESS_LEVEL = 6
+_CHUNK = 1 << 20
+
+
+def is_compressed(path: str) -> bool:
+    return path.endswith(GZ_EXT)
+
+
+def plain_name(path: str) -> str:
+    """File name of the test without the compression suffix"""
+    name = os.path.basename(path)
+    return name[:-len(GZ_EXT)] if is_compressed(name) else name
+
+
+class BlobWriter(gzip.GzipFile):
+    """Binary file writing a gzip blob to path.
+
+    The header has no file name and mtime 0, so equal contents give byte-identical blobs
+    (and equal cache keys).
+    """
+
+    def __init__(self, path: str):
+        self._raw = open(path, "wb")
+        super().__init__(filename="", mode="wb", compresslevel=COMPRESS_LEVEL, fileobj=self._raw, mtime=0)
+
+    def close(self):
+        try:
+            super().close()
+        finally:
+            self._raw.close()
+
+
+def compress_file(src_path: str, dst_path: str):
+    with open(src_path, "rb") as src, BlobWriter(dst_path) as dst:
+        for chunk in iter(lambda: src.read(_CHUNK), b""):
+            dst.write(chunk)
+
+
+def decompress_file(src_path: str, dst_path: str):
+    with gzip.open(src_path, "rb") as src, open(dst_path, "wb") as dst:
+        for chunk in iter(lambda: src.read(_CHUNK), b""):
+            dst.write(chunk)
+
+
+def plain_size(path: str) -> int:
+    """Size of the plain contents of a test file, from the gzip trailer for a compressed one"""
+    if not is_compressed(path):
+        return os.path.getsize(path)
+    with open(path, "rb") as f:
+        f.seek(-4, os.SEEK_END)
+        return struct.unpack("<I", f.read(4))[0]  # ISIZE, modulo 2^32 like the zip entry size
+
+
+def read_text(path: str) -> str:
+    """Contents of a plain or compressed test file"""
+    if is_compressed(path):
+        with gzip.open(path, "rt") as f:
+            return f.read()
+    with open(path, "r") as f:
+        return f.read()
+
+
+def open_plain(path: str):
+    """Binary file object reading the plain contents of a test file"""
+    return gzip.open(path, "rb") if is_compressed(path) else open(path, "rb")
+
+
+def open_stdin(path: str) -> int:
+    """Readable file descriptor with the plain contents of a test file, for stdin_fd= or Popen(stdin=).
+
+    A compressed file is decompressed on the fly into a pipe by a background thread, which stops
+    early if the reader closes the pipe. The caller closes the descriptor.
+    """
+    if not is_compressed(path):
+        return os.open(path, os.O_RDONLY)
+    read_fd, write_fd = os.pipe()
+
+    def feed():
+        try:
+            with gzip.open(path, "rb") as src:
+                for chunk in iter(lambda: src.read(_CHUNK), b""):
+                    view = memoryview(chunk)
+                    while view:
+                        view = view[os.write(write_fd, view):]
+        except BrokenPipeError:
+            pass
+        except (OSError, EOFError, zlib.error) as exc:
+            logger.error(f"Failed to decompress {path}: {exc}")
+        finally:
+            os.close(write_fd)
+
+    threading.Thread(target=feed, name=f"inflate-{os.path.basename(path)}", daemon=True).start()
+    return read_fd
+
+
+class BlobSink:
+    """Write end of a pipe whose data is compressed into a gzip blob at path, for stdout_fd=.
+
+    close() waits until the blob is complete, call it after the writing program exited.
+    """
+
+    def __init__(self, path: str):
+        self.path = path
+        read_fd, self.fd = os.pipe()
+        self._error: Optional[BaseException] = None
+        self._thread = threading.Thread(target=self._drain, args=(read_fd,),
+                                        name=f"deflate-{os.path.basename(path)}", daemon=True)
+        self._thread.start()
+
+    def _drain(self, read_fd: int):
+        try:
+            with BlobWriter(self.path) as dst:
+                for chunk in iter(lambda: os.read(read_fd, _CHUNK), b""):
+                    dst.write(chunk)
+        except BaseException as exc:
+            self._error = exc
+        finally:
+            os.close(read_fd)
+
+    def close(self):
+        if self.fd is not None:
+            os.close(self.fd)
+            self.fd = None
+        self._thread.join()
+        if self._error is not None:
+            raise self._error
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+class PlainCopies:
+    """Decompressed copies of compressed test files, for programs that only take file paths (checkers).
+
+    The capacity most recently used copies are kept, so a checker server sees the same file
+    (name and stat) for every output checked against one input. Copies in use are never removed.
+    """
+
+    def __init__(self, capacity: int = 16):
+        self.capacity = capacity
+        self._dir: Optional[str] = None
+        self._entries: OrderedDict[str, list] = OrderedDict()  # compressed path -> [plain path, users]
+        self._counter = 0
+        self._lock = threading.Lock()
+
+    @contextlib.contextmanager
+    def plain(self, path: str):
+        """Yield a plain file with the contents of path, path itself when it isn't compressed"""
+        if not is_compressed(path):
+            yield path
+            return
+        with self._lock:
+            entry = self._entries.get(path)
+            if entry is None:
+                if self._dir is None:
+                    self._dir = tempfile.mkdtemp(prefix="pygenlib-plain-")
+                self._counter += 1
+                plain_path = os.path.join(self._dir, f"{self._counter}-{plain_name(path)}")
+                decompress_file(path, plain_path)
+                entry = self._entries[path] = [plain_path, 0]
+            self._entries.move_to_end(path)
+            entry[1] += 1
+            self._evict()
+        try:
+            yield entry[0]
+        finally:
+            with self._lock:
+                entry[1] -= 1
+                self._evict()
+
+    def _evict(self):
+        for path in list(self._entries):
+            if len(self._entries) <= self.capacity:
+                break
+            plain_path, users = self._entries[path]
+            if users == 0:
+                del self._entries[path]
+                os.remove(plain_path)
+
+    def close(self):
+        with self._lock:
+            if self._dir is not None:
+                shutil.rmtree(self._dir, ignore_errors=True)
+            self._dir = None
+            self._entries.clear()
+
+
+def build_archive(tests_dir: str, archive_path: str) -> int:
+    """Write every file of tests_dir into the zip archive_path, returns the number of entries.
+
+    Compressed tests are stored under their plain name with their deflate data copied verbatim,
+    only plain files are compressed here. Entries are sorted by name and dated 1980-01-01,
+    so the same tests always give the same archive.
+    """
+    entries = sorted(
+        (plain_name(name), os.path.join(tests_dir, name))
+        for name in os.listdir(tests_dir) if os.path.isfile(os.path.join(tests_dir, name))
+    )
+    names = [name for name, _ in entries]
+    duplicates = sorted({name for name in names if names.count(name) > 1})
+    if duplicates:
+        raise ValueError(f"tests stored both plain and compressed in {tests_dir}: {', '.join(duplicates)}")
+
+    os.makedirs(os.path.dirname(archive_path) or ".", exist_ok=True)
+    tmp_path = archive_path + ".tmp"
+    central = []
+    with open(tmp_path, "wb") as out:
+        for name, path in entries:
+            offset = out.tell()
+            header_pos = offset + 30 + len(name.encode())
+            out.write(_local_header(name, 0, 0, 0))
+            if is_compressed(path):
+                crc, compressed_size, size = _copy_gzip_deflate(path, out)
+            else:
+                crc, compressed_size, size = _deflate_file(path, out)
+            if max(compressed_size, size, offset) >= 0xFFFFFFFF:
+                raise ValueError(f"{path} is too large for a zip archive without zip64")
+            end = out.tell()
+            out.seek(offset)
+            out.write(_local_header(name, crc, compressed_size, size))
+            assert out.tell() == header_pos
+            out.seek(end)
+            central.append((name, crc, compressed_size, size, offset))
+        central_offset = out.tell()
+        for name, crc, compressed_size, size, offset in central:
+            encoded = name.encode()
+            out.write(struct.pack("<IHHHHHHIIIHHHHHII", 0x02014B50, 20, 20, 0, 8, 0, _DOS_DATE,
+                                  crc, compressed_size, size, len(encoded), 0, 0, 0, 0, 0o644 << 16, offset))
+            out.write(encoded)
+        central_size = out.tell() - central_offset
+        out.write(struct.pack("<IHHHHIIH", 0x06054B50, 0, 0, len(central), len(central),
+                              central_size, central_offset, 0))
+    os.replace(tmp_path, archive_path)
+    logger.info(f"Wrote {len(entries)} test files to {archive_path}")
+    return len(entries)
+
+
+_DOS_DATE = (0 << 9) | (1 << 5) | 1  # 1980-01-01, the time field is 00:00:00
+
+
+def _local_header(name: str, crc: int, compressed_size: int, size: int) -> bytes:
+    encoded = name.encode()
+    return struct.pack("<IHHHHHIIIHH", 0x04034B50, 20, 0, 8, 0, _DOS_DATE,
+                       crc, compressed_size, size, len(encoded), 0) + encoded
+
+
+def _copy_gzip_deflate(path: str, out) -> tuple[int, int, int]:
+    """Copy the deflate data of a single-member gzip file to out, returns (crc32, compressed size, size)"""
+    file_size = os.path.getsize(path)
+    with open(path, "rb") as f:
+        magic, method, flags = struct.unpack("<HBB", f.read(4))
+        if magic != 0x8B1F or method != 8:
+            raise ValueError(f"{path} is not a gzip file")
+        f.read(6)  # mtime, extra flags, OS
+        if flags & 0x04:  # FEXTRA
+            f.read(struct.unpack("<H", f.read(2))[0])
+        for flag in (0x08, 0x10):  # FNAME, FCOMMENT: zero-terminated
+            if flags & flag:
+                while f.read(1) not in (b"\0", b""):
+                    pass
+        if flags & 0x02:  # FHCRC
+            f.read(2)
+        start = f.tell()
+        compressed_size = file_size - 8 - start
+        remaining = compressed_size
+        while remaining > 0:
+            chunk = f.read(min(_CHUNK, remaining))
+            if not chunk:
+                raise ValueError(f"{path} is truncated")
+            out.write(chunk)
+            remaining -= len(chunk)
+        crc, size = struct.unpack("<II", f.read(8))
+    return crc, compressed_size, size
+
+
+def _deflate_file(path: str, out) -> tuple[int, int, int]:
+    compressor = zlib.compressobj(COMPRESS_LEVEL, zlib.DEFLATED, -15)
+    crc = size = compressed_size = 0
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(_CHUNK), b""):
+            crc = zlib.crc32(chunk, crc)
+            size += len(chunk)
+            data = compressor.compress(chunk)
+            compressed_size += len(data)
+            out.write(data)
+    data = compressor.flush()
+    compressed_size += len(data)
+    out.write(data)
+    return crc, compressed_size, size
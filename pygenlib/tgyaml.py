@@ -52,4 +52,97 @@ def record_tg(st:int, tg:int, pts:int, public=False, c=None):
     default_tg_yaml.record_tg(st, tg, pts, public, c)
 
 def export_yaml(yaml_path="task.yaml"):
-    default_tg_yaml.export_yaml(yaml_path)
\ No newline at end of file
+    default_tg_yaml.export_yaml(yaml_path)
+
+def read_task_yaml(yaml_path="task.yaml") -> dict:
+    """Read a task.yaml into a dict: time_limit, memory_limit, subtask_points, tests_groups, ...
+
+    Understands the subset of YAML used by task files (mappings, block lists, flow lists
+    like [1, 2], quoted strings, numbers, booleans and # comments), so no YAML library is needed.
+    """
+    lines = []
+    with open(yaml_path, "r") as f:
+        for raw in f:
+            text = _strip_yaml_comment(raw).rstrip()
+            if text.strip() and not text.lstrip().startswith("#"):
+                lines.append((len(text) - len(text.lstrip()), text.strip()))
+    value, _ = _parse_yaml_block(lines, 0, lines[0][0] if lines else 0)
+    return value or {}
+
+
+def read_testgroups(task: dict) -> dict[int, dict]:
+    """Testgroups of a parsed task.yaml: testgroup number -> its tests_groups entry (points, subtask, public, ...).
+
+    An entry's groups is a single testgroup or an interval [first, last], every testgroup of it
+    is worth the entry's points.
+    """
+    testgroups = {}
+    for entry in task.get("tests_groups") or []:
+        groups = entry.get("groups")
+        first, last = (groups[0], groups[-1]) if isinstance(groups, list) else (groups, groups)
+        for tg in range(int(first), int(last) + 1):
+            testgroups[tg] = entry
+    return testgroups
+
+
+def _parse_yaml_block(lines, i, indent):
+    if lines[i][1].startswith("-"):
+        items = []
+        while i < len(lines) and lines[i][0] == indent and lines[i][1].startswith("-"):
+            item = lines[i][1][1:].strip()
+            if _is_yaml_key(item):
+                # "- key: value" starts a mapping indented like the text after the dash
+                item_indent = indent + len(lines[i][1]) - len(item)
+                lines[i] = (item_indent, item)
+                value, i = _parse_yaml_block(lines, i, item_indent)
+            else:
+                value, i = _parse_yaml_scalar(item), i + 1
+            items.append(value)
+        return items, i
+
+    mapping = {}
+    while i < len(lines) and lines[i][0] == indent and _is_yaml_key(lines[i][1]):
+        key, _, rest = lines[i][1].partition(":")
+        i += 1
+        if rest.strip():
+            mapping[key.strip()] = _parse_yaml_scalar(rest.strip())
+        elif i < len(lines) and lines[i][0] > indent:
+            mapping[key.strip()], i = _parse_yaml_block(lines, i, lines[i][0])
+        else:
+            mapping[key.strip()] = None
+    return mapping, i
+
+
+def _strip_yaml_comment(text: str) -> str:
+    """Line without its comment, a # starts one at the line start or after whitespace, outside quotes"""
+    quote = None
+    for i, c in enumerate(text):
+        if quote is not None:
+            if c == quote:
+                quote = None
+        elif c in "'\"" and (i == 0 or text[i - 1] in " \t[,:-"):
+            quote = c
+        elif c == "#" and (i == 0 or text[i - 1] in " \t"):
+            return text[:i]
+    return text
+
+
+def _is_yaml_key(text: str) -> bool:
+    key, sep, rest = text.partition(":")
+    return bool(sep) and key.strip() != "" and not key.startswith(("'", '"', "[")) and (rest == "" or rest[0] == " ")
+
+
+def _parse_yaml_scalar(text: str):
+    if text.startswith("[") and text.endswith("]"):
+        inner = text[1:-1].strip()
+        return [_parse_yaml_scalar(part.strip()) for part in inner.split(",")] if inner else []
+    if len(text) >= 2 and text[0] == text[-1] and text[0] in "'\"":
+        return text[1:-1]
+    if text.lower() in ("true", "false"):
+        return text.lower() == "true"
+    for parse in (int, float):
+        try:
+            return parse(text)
+        except ValueError:
+            pass
+    return text
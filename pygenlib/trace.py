@@ -0,0 +1,152 @@
+from collections import defaultdict
+from typing import Callable, Optional
+import contextlib
+import csv
+import functools
+import json
+import logging
+import os
+import threading
+import time
+
+logger = logging.getLogger(__name__)
+
+# Pipeline instrumentation. Stages record spans (name, category, start, duration, args such as bytes)
+# and caches their hits and misses; write() exports them as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+# and a summary table. Recording is off until enable(), spans then cost one dict per stage.
+
+_lock = threading.Lock()
+_enabled = False
+_origin = 0.0
+_events: list[dict] = []
+_caches: dict[str, list[int]] = defaultdict(lambda: [0, 0])  # name -> [hits, misses]
+_threads: dict[int, tuple[int, str]] = {}  # thread ident -> (trace tid, thread name)
+
+
+def enable():
+    """Start recording, dropping everything recorded before"""
+    global _enabled, _origin
+    with _lock:
+        _events.clear()
+        _caches.clear()
+        _threads.clear()
+        _origin = time.perf_counter()
+        _enabled = True
+
+
+def disable():
+    global _enabled
+    _enabled = False
+
+
+def is_enabled() -> bool:
+    return _enabled
+
+
+@contextlib.contextmanager
+def span(name: str, category: str = "pipeline", **args):
+    """Record the duration of the with block as a stage.
+
+    Yields the span's args, a stage adds what it measured (e.g. args["bytes"]) before the block ends.
+    """
+    if not _enabled:
+        yield {}
+        return
+    start = time.perf_counter()
+    try:
+        yield args
+    finally:
+        _record(name, category, start, time.perf_counter(), args)
+
+
+def traced(name: Optional[str] = None, category: str = "pipeline") -> Callable:
+    """Decorator recording every call of a function as a span, named after the function by default"""
+    def decorate(func):
+        @functools.wraps(func)
+        def wrapper(*args, **kwargs):
+            with span(name or func.__name__, category):
+                return func(*args, **kwargs)
+        return wrapper
+    return decorate
+
+
+def cache(name: str, hit: bool):
+    """Count a lookup of the named cache"""
+    if not _enabled:
+        return
+    with _lock:
+        _caches[name][0 if hit else 1] += 1
+
+
+def file_size(path: Optional[str]) -> int:
+    """Size of a file written by a stage, 0 if it doesn't exist"""
+    try:
+        return os.path.getsize(path) if path else 0
+    except OSError:
+        return 0
+
+
+def _record(name: str, category: str, start: float, end: float, args: dict):
+    thread = threading.current_thread()
+    with _lock:
+        if not _enabled:
+            return
+        tid = _threads.setdefault(thread.ident, (len(_threads) + 1, thread.name))[0]
+        _events.append({"name": name, "cat": category, "ph": "X", "pid": os.getpid(), "tid": tid,
+                        "ts": round((start - _origin) * 1e6), "dur": round((end - start) * 1e6), "args": args})
+
+
+def summary() -> list[dict]:
+    """Per stage: calls, total/mean/max seconds and bytes, stages sorted by total time"""
+    with _lock:
+        events = list(_events)
+    stages: dict[tuple, dict] = {}
+    for event in events:
+        stage = stages.setdefault((event["cat"], event["name"]), {
+            "category": event["cat"], "stage": event["name"], "calls": 0, "total_sec": 0.0, "max_sec": 0.0, "bytes": 0})
+        seconds = event["dur"] / 1e6
+        stage["calls"] += 1
+        stage["total_sec"] += seconds
+        stage["max_sec"] = max(stage["max_sec"], seconds)
+        stage["bytes"] += int(event["args"].get("bytes", 0))
+    for stage in stages.values():
+        stage["mean_sec"] = stage["total_sec"] / stage["calls"]
+    return sorted(stages.values(), key=lambda stage: -stage["total_sec"])
+
+
+def cache_summary() -> list[dict]:
+    with _lock:
+        caches = {name: tuple(counts) for name, counts in _caches.items()}
+    return [{"cache": name, "hits": hits, "misses": misses, "hit_rate": hits / (hits + misses)}
+            for name, (hits, misses) in sorted(caches.items()) if hits + misses]
+
+
+def write(base_path: str):
+    """Write the Chrome trace to {base_path}.json and the stage and cache summary to {base_path}.tsv"""
+    os.makedirs(os.path.dirname(base_path) or ".", exist_ok=True)
+    with _lock:
+        events = list(_events)
+        threads = dict(_threads)
+    metadata = [{"name": "thread_name", "ph": "M", "pid": os.getpid(), "tid": tid, "args": {"name": thread_name}}
+                for tid, thread_name in threads.values()]
+    with open(f"{base_path}.json", "w") as f:
+        json.dump({"traceEvents": metadata + events, "displayTimeUnit": "ms",
+                   "otherData": {"caches": cache_summary()}}, f)
+
+    stages = summary()
+    caches = cache_summary()
+    with open(f"{base_path}.tsv", "w", newline="") as f:
+        writer = csv.writer(f, delimiter="\t")
+        writer.writerow(["category", "stage", "calls", "[total sec]", "[mean sec]", "[max sec]", "[mib]", "[mib/s]"])
+        for stage in stages:
+            mib = stage["bytes"] / (1 << 20)
+            writer.writerow([stage["category"], stage["stage"], stage["calls"], f"{stage['total_sec']:.3f}",
+                             f"{stage['mean_sec']:.4f}", f"{stage['max_sec']:.3f}", f"{mib:.2f}",
+                             f"{mib / stage['total_sec']:.1f}" if stage["bytes"] and stage["total_sec"] else "-"])
+        writer.writerow([])
+        writer.writerow(["cache", "hits", "misses", "[hit %]"])
+        for entry in caches:
+            writer.writerow([entry["cache"], entry["hits"], entry["misses"], f"{entry['hit_rate']:.0%}"])
+    for stage in stages[:10]:
+        logger.info(f"{stage['category']}/{stage['stage']}: {stage['calls']} calls, {stage['total_sec']:.2f}s")
+    logger.info(f"Trace written to {base_path}.json, summary to {base_path}.tsv")